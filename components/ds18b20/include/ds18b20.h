@@ -0,0 +1,239 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "onewire_device.h"
+#include "ds18b20_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of DS18B20 device handle
+ */
+typedef struct ds18b20_device_t *ds18b20_device_handle_t;
+
+/**
+ * @brief DS18B20 configuration
+ */
+typedef struct {
+} ds18b20_config_t;
+
+/**
+ * @brief State of a temperature conversion that has been started but not finished yet
+ */
+typedef struct {
+    ds18b20_wait_mode_t wait_mode;   /*!< Set by the caller before starting the conversion, zero means DS18B20_WAIT_MODE_DELAY */
+    onewire_bus_handle_t bus;        /*!< Which bus the conversion is running on */
+    ds18b20_device_handle_t ds18b20; /*!< Which device is converting, NULL if all devices on the bus are converting */
+    int64_t start_us;                /*!< Time when Convert T was issued, in microseconds since boot */
+    int64_t deadline_us;             /*!< Time by which the conversion is guaranteed to be finished, in microseconds since boot */
+    int64_t elapsed_us;              /*!< Measured conversion time once finished in DS18B20_WAIT_MODE_POLL, 0 if not measured */
+    bool done;                       /*!< Set once the conversion is known to be finished */
+} ds18b20_conversion_t;
+
+/**
+ * @brief Create a new DS18B20 device based on the general 1-Wire device
+ *
+ * @note The general 1-Wire device can be enumerated during the 1-Wire bus device search process,
+ *       this function is going to check and upgrade that into a DS18B20 device.
+ *
+ * @param[in] device 1-Wire device basic information, including bus handle and device ROM ID
+ * @param[in] config DS18B20 configuration
+ * @param[out] ret_ds18b20 Returned DS18B20 device handle
+ * @return
+ *      - ESP_OK: Create DS18B20 device successfully
+ *      - ESP_ERR_INVALID_ARG: Create DS18B20 device failed due to invalid argument
+ *      - ESP_ERR_NO_MEM: Create DS18B20 device failed due to out of memory
+ *      - ESP_ERR_NOT_SUPPORTED: Create DS18B20 device failed because the device is unknown (e.g. a wrong family ID code)
+ *      - ESP_FAIL: Create DS18B20 device failed due to other reasons
+ */
+esp_err_t ds18b20_new_device(onewire_device_t *device, const ds18b20_config_t *config, ds18b20_device_handle_t *ret_ds18b20);
+
+/**
+ * @brief Create a new singe device bus DS18B20 device based on a 1-Wire bus (not enumerated)
+ *        this function assumes that the device is a DS18B20 device and there is only one device on the bus
+ *
+ * @param[in] bus 1-Wire bus handle
+ * @param[in] config DS18B20 configuration
+ * @param[out] ret_ds18b20 Returned DS18B20 device handle
+ * @return esp_err_t
+ *      - ESP_OK: Create DS18B20 device successfully
+ *      - ESP_ERR_INVALID_ARG: Create DS18B20 device failed due to invalid argument
+ *      - ESP_ERR_NO_MEM: Create DS18B20 device failed due to out of memory
+ *      - ESP_FAIL: Create DS18B20 device failed due to other reasons
+ */
+esp_err_t ds18b20_new_single_device(onewire_bus_handle_t bus, const ds18b20_config_t *config, ds18b20_device_handle_t *ret_ds18b20);
+
+/**
+ * @brief Trigger temperature conversion of all DS18B20 devices on the bus at once
+ *
+ * @note This function addresses every device with a single Skip ROM + Convert T sequence,
+ *       so N sensors share one conversion window instead of converting one after another.
+ *       It will delay for the worst-case conversion time (12-bit), after which the result of each device
+ *       can be fetched by `ds18b20_get_temperature`, which addresses the device by Match ROM.
+ *
+ * @param[in] bus 1-Wire bus handle
+ * @return
+ *      - ESP_OK: Trigger temperature conversion successfully
+ *      - ESP_ERR_INVALID_ARG: Trigger temperature conversion failed due to invalid argument
+ *      - ESP_ERR_NOT_FOUND: Trigger temperature conversion failed because no device is present on the bus
+ *      - ESP_FAIL: Trigger temperature conversion failed due to other reasons
+ */
+esp_err_t ds18b20_trigger_temperature_conversion_for_all(onewire_bus_handle_t bus);
+
+/**
+ * @brief Delete DS18B20 device
+ *
+ * @param ds18b20 DS18B20 device handle returned by `ds18b20_new_device`
+ * @return
+ *      - ESP_OK: Delete DS18B20 device successfully
+ *      - ESP_ERR_INVALID_ARG: Delete DS18B20 device failed due to invalid argument
+ *      - ESP_FAIL: Delete DS18B20 device failed due to other reasons
+ */
+esp_err_t ds18b20_del_device(ds18b20_device_handle_t ds18b20);
+
+/**
+ * @brief Set DS18B20's temperature conversion resolution
+ *
+ * @param[in] ds18b20 DS18B20 device handle returned by `ds18b20_new_device`
+ * @param[in] resolution resolution of DS18B20's temperature conversion
+ * @return
+ *      - ESP_OK: Set resolution successfully
+ *      - ESP_ERR_INVALID_ARG: Set resolution failed due to invalid argument
+ *      - ESP_FAIL: Set resolution failed due to other reasons
+ */
+esp_err_t ds18b20_set_resolution(ds18b20_device_handle_t ds18b20, ds18b20_resolution_t resolution);
+
+/**
+ * @brief Set DS18B20's alarm thresholds (TH and TL registers)
+ *
+ * @note After each temperature conversion, the device sets its alarm flag if the temperature is >= TH or <= TL,
+ *       only the integer part of the temperature is compared. Devices with the alarm flag set answer the Alarm Search.
+ * @note The thresholds are only written to the scratchpad, they are lost on power cycle.
+ *
+ * @param[in] ds18b20 DS18B20 device handle returned by `ds18b20_new_device`
+ * @param[in] th high alarm threshold, in degrees Celsius
+ * @param[in] tl low alarm threshold, in degrees Celsius
+ * @return
+ *      - ESP_OK: Set alarm thresholds successfully
+ *      - ESP_ERR_INVALID_ARG: Set alarm thresholds failed due to invalid argument
+ *      - ESP_FAIL: Set alarm thresholds failed due to other reasons
+ */
+esp_err_t ds18b20_set_alarm_thresholds(ds18b20_device_handle_t ds18b20, int8_t th, int8_t tl);
+
+/**
+ * @brief Trigger temperature conversion of DS18B20
+ *
+ * @note After send the trigger command, the DS18B20 will start temperature conversion.
+ *       This function will delay for some while, to ensure the temperature conversion won't be interrupted.
+ *
+ * @param[in] ds18b20 DS18B20 device handle returned by `ds18b20_new_device`
+ * @return
+ *      - ESP_OK: Trigger temperature conversion successfully
+ *      - ESP_ERR_INVALID_ARG: Trigger temperature conversion failed due to invalid argument
+ *      - ESP_FAIL: Trigger temperature conversion failed due to other reasons
+ */
+esp_err_t ds18b20_trigger_temperature_conversion(ds18b20_device_handle_t ds18b20);
+
+/**
+ * @brief Start temperature conversion of DS18B20 without waiting for it to finish
+ *
+ * @note The function returns right after the Convert T command is sent.
+ *       Use `ds18b20_poll_temperature_conversion` or `ds18b20_finish_temperature_conversion` to learn when the result is ready.
+ *
+ * @param[in] ds18b20 DS18B20 device handle returned by `ds18b20_new_device`
+ * @param[out] ret_conversion Returned conversion state, including the deadline of the conversion
+ * @return
+ *      - ESP_OK: Start temperature conversion successfully
+ *      - ESP_ERR_INVALID_ARG: Start temperature conversion failed due to invalid argument
+ *      - ESP_FAIL: Start temperature conversion failed due to other reasons
+ */
+esp_err_t ds18b20_start_temperature_conversion(ds18b20_device_handle_t ds18b20, ds18b20_conversion_t *ret_conversion);
+
+/**
+ * @brief Start temperature conversion of all DS18B20 devices on the bus without waiting for it to finish
+ *
+ * @param[in] bus 1-Wire bus handle
+ * @param[in] resolution The highest resolution configured on any device of the bus, which decides the deadline
+ * @param[out] ret_conversion Returned conversion state, including the deadline of the conversion
+ * @return
+ *      - ESP_OK: Start temperature conversion successfully
+ *      - ESP_ERR_INVALID_ARG: Start temperature conversion failed due to invalid argument
+ *      - ESP_ERR_NOT_FOUND: Start temperature conversion failed because no device is present on the bus
+ *      - ESP_FAIL: Start temperature conversion failed due to other reasons
+ */
+esp_err_t ds18b20_start_temperature_conversion_for_all(onewire_bus_handle_t bus, ds18b20_resolution_t resolution, ds18b20_conversion_t *ret_conversion);
+
+/**
+ * @brief Check whether a started temperature conversion has finished, this function never blocks
+ *
+ * @note In DS18B20_WAIT_MODE_POLL, one read slot is issued to ask the converting device(s) whether they are done.
+ *       When several devices convert at once, the bus only reads 1 after the slowest one has finished.
+ *
+ * @param[in] conversion Conversion state returned by `ds18b20_start_temperature_conversion(_for_all)`
+ * @return
+ *      - ESP_OK: The conversion has finished, the result can be read by `ds18b20_get_temperature`
+ *      - ESP_ERR_NOT_FINISHED: The conversion is still in progress
+ *      - ESP_ERR_INVALID_ARG: Check conversion failed due to invalid argument
+ *      - ESP_FAIL: Check conversion failed because the read slot could not be issued
+ */
+esp_err_t ds18b20_poll_temperature_conversion(ds18b20_conversion_t *conversion);
+
+/**
+ * @brief Wait until a started temperature conversion has finished
+ *
+ * @note Only the remaining time until the deadline is waited, so any work done after starting the conversion is free.
+ *
+ * @param[in] conversion Conversion state returned by `ds18b20_start_temperature_conversion(_for_all)`
+ * @return
+ *      - ESP_OK: The conversion has finished, the result can be read by `ds18b20_get_temperature`
+ *      - ESP_ERR_INVALID_ARG: Wait conversion failed due to invalid argument
+ *      - ESP_FAIL: Wait conversion failed because the read slot could not be issued
+ */
+esp_err_t ds18b20_finish_temperature_conversion(ds18b20_conversion_t *conversion);
+
+/**
+ * @brief Get the worst-case conversion time of a resolution, the budget used for `ds18b20_conversion_t::deadline_us`
+ *
+ * @param[in] resolution Conversion resolution
+ * @return Conversion time in milliseconds
+ */
+uint32_t ds18b20_get_conversion_time_ms(ds18b20_resolution_t resolution);
+
+/**
+ * @brief Get the conversion time counters of DS18B20
+ *
+ * @note Only conversions finished in DS18B20_WAIT_MODE_POLL are counted. A bus-wide conversion started by
+ *       `ds18b20_start_temperature_conversion_for_all` is counted for every device on that bus, with the time of the slowest one.
+ *
+ * @param[in] ds18b20 DS18B20 device handle returned by `ds18b20_new_device`
+ * @param[out] ret_stats Returned conversion time counters
+ * @return
+ *      - ESP_OK: Get conversion time counters successfully
+ *      - ESP_ERR_INVALID_ARG: Get conversion time counters failed due to invalid argument
+ */
+esp_err_t ds18b20_get_conversion_stats(ds18b20_device_handle_t ds18b20, ds18b20_conversion_stats_t *ret_stats);
+
+/**
+ * @brief Get temperature from DS18B20
+ *
+ * @param[in] ds18b20 DS18B20 device handle returned by `ds18b20_new_device`
+ * @param[out] temperature conversion result from DS18B20
+ * @return
+ *      - ESP_OK: Get temperature successfully
+ *      - ESP_ERR_INVALID_ARG: Get temperature failed due to invalid argument
+ *      - ESP_ERR_INVALID_CRC: Get temperature failed due to CRC check error
+ *      - ESP_FAIL: Get temperature failed due to other reasons
+ */
+esp_err_t ds18b20_get_temperature(ds18b20_device_handle_t ds18b20, float *temperature);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,51 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Family code of DS18B20, the lowest byte of its ROM number
+ */
+#define DS18B20_FAMILY_CODE 0x28
+
+/**
+ * @brief DS18B20 supported resolutions
+ */
+typedef enum {
+    DS18B20_RESOLUTION_9B,  /*!<  9bit, needs ~93.75ms convert time */
+    DS18B20_RESOLUTION_10B, /*!< 10bit, needs ~187.5ms convert time */
+    DS18B20_RESOLUTION_11B, /*!< 11bit, needs ~375ms convert time */
+    DS18B20_RESOLUTION_12B, /*!< 12bit, needs ~750ms convert time */
+} ds18b20_resolution_t;
+
+/**
+ * @brief How to find out that a temperature conversion has finished
+ */
+typedef enum {
+    DS18B20_WAIT_MODE_DELAY, /*!< Wait the worst-case conversion time of the resolution */
+    DS18B20_WAIT_MODE_POLL,  /*!< Issue read slots until the sensor releases the bus, capped by the worst-case time.
+                                  Not usable with parasite powered sensors, and no other transaction may run on the bus meanwhile */
+} ds18b20_wait_mode_t;
+
+/**
+ * @brief Conversion time counters of a DS18B20, measured in DS18B20_WAIT_MODE_POLL
+ */
+typedef struct {
+    uint32_t count;    /*!< Number of measured conversions */
+    uint32_t last_us;  /*!< Duration of the latest measured conversion */
+    uint32_t min_us;   /*!< Shortest measured conversion */
+    uint32_t max_us;   /*!< Longest measured conversion */
+    uint64_t total_us; /*!< Sum of all measured conversions, divide by count to get the mean */
+} ds18b20_conversion_stats_t;
+
+#ifdef __cplusplus
+}
+#endif
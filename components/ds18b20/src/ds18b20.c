@@ -0,0 +1,339 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "onewire_bus.h"
+#include "onewire_cmd.h"
+#include "onewire_crc.h"
+#include "ds18b20.h"
+
+static const char *TAG = "ds18b20";
+
+#define DS18B20_CMD_CONVERT_TEMP      0x44
+#define DS18B20_CMD_WRITE_SCRATCHPAD  0x4E
+#define DS18B20_CMD_READ_SCRATCHPAD   0xBE
+
+#define DS18B20_MAX_PAYLOAD_SIZE      3 // Write Scratchpad carries TH, TL and configuration
+
+/**
+ * @brief Structure of DS18B20's scratchpad
+ */
+typedef struct  {
+    uint8_t temp_lsb;      /*!< lsb of temperature */
+    uint8_t temp_msb;      /*!< msb of temperature */
+    uint8_t th_user1;      /*!< th register or user byte 1 */
+    uint8_t tl_user2;      /*!< tl register or user byte 2 */
+    uint8_t configuration; /*!< resolution configuration register */
+    uint8_t _reserved1;
+    uint8_t _reserved2;
+    uint8_t _reserved3;
+    uint8_t crc_value;     /*!< crc value of scratchpad data */
+} __attribute__((packed)) ds18b20_scratchpad_t;
+
+// delay proper time for temperature conversion, indexed by ds18b20_resolution_t
+static const uint32_t s_conversion_delays_ms[] = {100, 200, 400, 800};
+
+typedef struct ds18b20_device_t {
+    onewire_bus_handle_t bus;
+    bool single_mode;
+    onewire_device_address_t addr;
+    uint8_t th_user1;
+    uint8_t tl_user2;
+    ds18b20_resolution_t resolution;
+    ds18b20_conversion_stats_t conversion_stats;
+    struct ds18b20_device_t *next; // in s_devices
+} ds18b20_device_t;
+
+// every device created, so a bus-wide conversion can credit its time to each device on that bus
+static ds18b20_device_t *s_devices = NULL;
+static portMUX_TYPE s_devices_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void ds18b20_link(ds18b20_device_t *ds18b20)
+{
+    portENTER_CRITICAL(&s_devices_lock);
+    ds18b20->next = s_devices;
+    s_devices = ds18b20;
+    portEXIT_CRITICAL(&s_devices_lock);
+}
+
+static void ds18b20_unlink(ds18b20_device_t *ds18b20)
+{
+    portENTER_CRITICAL(&s_devices_lock);
+    for (ds18b20_device_t **p = &s_devices; *p; p = &(*p)->next) {
+        if (*p == ds18b20) {
+            *p = ds18b20->next;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_devices_lock);
+}
+
+esp_err_t ds18b20_new_device(onewire_device_t *device, const ds18b20_config_t *config, ds18b20_device_handle_t *ret_ds18b20)
+{
+    ds18b20_device_t *ds18b20 = NULL;
+    ESP_RETURN_ON_FALSE(device && config && ret_ds18b20, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // check ROM ID, the family code of DS18B20 is 0x28
+    if ((device->address & 0xFF) != DS18B20_FAMILY_CODE) {
+        ESP_LOGD(TAG, "%016llX is not a DS18B20 device", device->address);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    ds18b20 = calloc(1, sizeof(ds18b20_device_t));
+    ESP_RETURN_ON_FALSE(ds18b20, ESP_ERR_NO_MEM, TAG, "no mem for ds18b20");
+    ds18b20->bus = device->bus;
+    ds18b20->addr = device->address;
+    ds18b20->resolution = DS18B20_RESOLUTION_12B; // DS18B20 default resolution is 12 bits
+    ds18b20_link(ds18b20);
+
+    *ret_ds18b20 = ds18b20;
+    return ESP_OK;
+}
+
+esp_err_t ds18b20_new_single_device(onewire_bus_handle_t bus, const ds18b20_config_t *config, ds18b20_device_handle_t *ret_ds18b20)
+{
+    ds18b20_device_t *ds18b20 = NULL;
+    ESP_RETURN_ON_FALSE(bus && config && ret_ds18b20, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    ds18b20 = calloc(1, sizeof(ds18b20_device_t));
+    ESP_RETURN_ON_FALSE(ds18b20, ESP_ERR_NO_MEM, TAG, "no mem for ds18b20");
+    ds18b20->bus = bus;
+    ds18b20->addr = 0;
+    ds18b20->single_mode = true;
+    ds18b20->resolution = DS18B20_RESOLUTION_12B; // DS18B20 default resolution is 12 bits
+    ds18b20_link(ds18b20);
+
+    *ret_ds18b20 = ds18b20;
+    return ESP_OK;
+}
+
+esp_err_t ds18b20_del_device(ds18b20_device_handle_t ds18b20)
+{
+    ESP_RETURN_ON_FALSE(ds18b20, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ds18b20_unlink(ds18b20);
+    free(ds18b20);
+    return ESP_OK;
+}
+
+// Reset, address the device, send the function command with its payload and read the answer, as one bus transaction
+static esp_err_t ds18b20_transaction(ds18b20_device_handle_t ds18b20, uint8_t cmd, const uint8_t *payload, size_t payload_size,
+                                     uint8_t *rx_buf, size_t rx_buf_size)
+{
+    uint8_t tx_buffer[1 + sizeof(onewire_device_address_t) + 1 + DS18B20_MAX_PAYLOAD_SIZE] = {0};
+    size_t tx_size = 0;
+    // No addres mode (singe device connectd to the bus) created using ds18b20_new_single_device
+    if (ds18b20->single_mode) {
+        tx_buffer[tx_size++] = ONEWIRE_CMD_SKIP_ROM;
+    } else {
+        tx_buffer[tx_size++] = ONEWIRE_CMD_MATCH_ROM;
+        memcpy(&tx_buffer[tx_size], &ds18b20->addr, sizeof(ds18b20->addr));
+        tx_size += sizeof(ds18b20->addr);
+    }
+    tx_buffer[tx_size++] = cmd;
+    if (payload_size) {
+        memcpy(&tx_buffer[tx_size], payload, payload_size);
+        tx_size += payload_size;
+    }
+
+    onewire_bus_transaction_t trans = {
+        .tx_data = tx_buffer,
+        .tx_data_size = tx_size,
+        .rx_buf = rx_buf,
+        .rx_buf_size = rx_buf_size,
+    };
+    return onewire_bus_transaction(ds18b20->bus, &trans);
+}
+
+// TH, TL and the configuration register can only be written together
+static esp_err_t ds18b20_write_scratchpad(ds18b20_device_handle_t ds18b20, uint8_t th_user1, uint8_t tl_user2, ds18b20_resolution_t resolution)
+{
+    const uint8_t resolution_data[] = {0x1F, 0x3F, 0x5F, 0x7F};
+    uint8_t tx_buffer[3] = {0};
+    tx_buffer[0] = th_user1;
+    tx_buffer[1] = tl_user2;
+    tx_buffer[2] = resolution_data[resolution];
+    // send command: DS18B20_CMD_WRITE_SCRATCHPAD
+    ESP_RETURN_ON_ERROR(ds18b20_transaction(ds18b20, DS18B20_CMD_WRITE_SCRATCHPAD, tx_buffer, sizeof(tx_buffer), NULL, 0),
+                        TAG, "write scratchpad failed");
+
+    ds18b20->th_user1 = th_user1;
+    ds18b20->tl_user2 = tl_user2;
+    ds18b20->resolution = resolution;
+    return ESP_OK;
+}
+
+esp_err_t ds18b20_set_resolution(ds18b20_device_handle_t ds18b20, ds18b20_resolution_t resolution)
+{
+    ESP_RETURN_ON_FALSE(ds18b20 && resolution <= DS18B20_RESOLUTION_12B, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // write new resolution to scratchpad, keep TH and TL
+    ESP_RETURN_ON_ERROR(ds18b20_write_scratchpad(ds18b20, ds18b20->th_user1, ds18b20->tl_user2, resolution),
+                        TAG, "send new resolution failed");
+    return ESP_OK;
+}
+
+esp_err_t ds18b20_set_alarm_thresholds(ds18b20_device_handle_t ds18b20, int8_t th, int8_t tl)
+{
+    ESP_RETURN_ON_FALSE(ds18b20, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // write new thresholds to scratchpad, keep the resolution
+    ESP_RETURN_ON_ERROR(ds18b20_write_scratchpad(ds18b20, (uint8_t)th, (uint8_t)tl, ds18b20->resolution),
+                        TAG, "send new alarm thresholds failed");
+    return ESP_OK;
+}
+
+static void ds18b20_conversion_begin(onewire_bus_handle_t bus, ds18b20_device_handle_t ds18b20, ds18b20_resolution_t resolution,
+                                     ds18b20_conversion_t *conversion)
+{
+    // wait_mode is chosen by the caller, keep it
+    conversion->bus = bus;
+    conversion->ds18b20 = ds18b20;
+    conversion->start_us = esp_timer_get_time();
+    conversion->deadline_us = conversion->start_us + (int64_t)s_conversion_delays_ms[resolution] * 1000;
+    conversion->elapsed_us = 0;
+    conversion->done = false;
+}
+
+// called with s_devices_lock held
+static void ds18b20_record_conversion_time(ds18b20_device_handle_t ds18b20, uint32_t elapsed_us)
+{
+    ds18b20_conversion_stats_t *stats = &ds18b20->conversion_stats;
+    if (stats->count == 0 || elapsed_us < stats->min_us) {
+        stats->min_us = elapsed_us;
+    }
+    if (elapsed_us > stats->max_us) {
+        stats->max_us = elapsed_us;
+    }
+    stats->last_us = elapsed_us;
+    stats->total_us += elapsed_us;
+    stats->count++;
+}
+
+esp_err_t ds18b20_start_temperature_conversion(ds18b20_device_handle_t ds18b20, ds18b20_conversion_t *ret_conversion)
+{
+    ESP_RETURN_ON_FALSE(ds18b20 && ret_conversion, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // send command: DS18B20_CMD_CONVERT_TEMP
+    ESP_RETURN_ON_ERROR(ds18b20_transaction(ds18b20, DS18B20_CMD_CONVERT_TEMP, NULL, 0, NULL, 0), TAG, "send DS18B20_CMD_CONVERT_TEMP failed");
+
+    ds18b20_conversion_begin(ds18b20->bus, ds18b20, ds18b20->resolution, ret_conversion);
+    return ESP_OK;
+}
+
+esp_err_t ds18b20_start_temperature_conversion_for_all(onewire_bus_handle_t bus, ds18b20_resolution_t resolution, ds18b20_conversion_t *ret_conversion)
+{
+    ESP_RETURN_ON_FALSE(bus && ret_conversion && resolution <= DS18B20_RESOLUTION_12B, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // broadcast command: DS18B20_CMD_CONVERT_TEMP to every device on the bus
+    uint8_t tx_buffer[2] = {ONEWIRE_CMD_SKIP_ROM, DS18B20_CMD_CONVERT_TEMP};
+    onewire_bus_transaction_t trans = {
+        .tx_data = tx_buffer,
+        .tx_data_size = sizeof(tx_buffer),
+    };
+    ESP_RETURN_ON_ERROR(onewire_bus_transaction(bus, &trans), TAG, "send DS18B20_CMD_CONVERT_TEMP failed");
+
+    ds18b20_conversion_begin(bus, NULL, resolution, ret_conversion);
+    return ESP_OK;
+}
+
+esp_err_t ds18b20_poll_temperature_conversion(ds18b20_conversion_t *conversion)
+{
+    ESP_RETURN_ON_FALSE(conversion && conversion->bus, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (conversion->done) {
+        return ESP_OK;
+    }
+
+    if (conversion->wait_mode == DS18B20_WAIT_MODE_POLL) {
+        // a converting DS18B20 answers read slots with 0, and with 1 once the conversion is done
+        uint8_t rx_bit = 0;
+        ESP_RETURN_ON_ERROR(onewire_bus_read_bit(conversion->bus, &rx_bit), TAG, "read conversion status failed");
+        int64_t now = esp_timer_get_time();
+        if (rx_bit) {
+            conversion->elapsed_us = now - conversion->start_us;
+            conversion->done = true;
+            // a bus-wide conversion ends with its slowest device, that time is all the bus tells about each of them
+            portENTER_CRITICAL(&s_devices_lock);
+            for (ds18b20_device_t *dev = s_devices; dev; dev = dev->next) {
+                if (conversion->ds18b20 ? dev == conversion->ds18b20 : dev->bus == conversion->bus) {
+                    ds18b20_record_conversion_time(dev, (uint32_t)conversion->elapsed_us);
+                }
+            }
+            portEXIT_CRITICAL(&s_devices_lock);
+        } else if (now >= conversion->deadline_us) {
+            // never wait longer than the datasheet limit, even if the bus doesn't look released
+            ESP_LOGD(TAG, "no conversion done signal before the deadline");
+            conversion->done = true;
+        }
+    } else if (esp_timer_get_time() >= conversion->deadline_us) {
+        conversion->done = true;
+    }
+    return conversion->done ? ESP_OK : ESP_ERR_NOT_FINISHED;
+}
+
+esp_err_t ds18b20_finish_temperature_conversion(ds18b20_conversion_t *conversion)
+{
+    ESP_RETURN_ON_FALSE(conversion && conversion->bus, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    esp_err_t ret;
+    while ((ret = ds18b20_poll_temperature_conversion(conversion)) == ESP_ERR_NOT_FINISHED) {
+        TickType_t ticks = 1; // poll the bus once per tick
+        if (conversion->wait_mode == DS18B20_WAIT_MODE_DELAY) {
+            // sleep the remaining time, rounded up to whole ticks
+            int64_t remaining_ms = (conversion->deadline_us - esp_timer_get_time() + 999) / 1000;
+            ticks = (remaining_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+        }
+        vTaskDelay(ticks > 0 ? ticks : 1);
+    }
+    return ret;
+}
+
+uint32_t ds18b20_get_conversion_time_ms(ds18b20_resolution_t resolution)
+{
+    return resolution <= DS18B20_RESOLUTION_12B ? s_conversion_delays_ms[resolution] : s_conversion_delays_ms[DS18B20_RESOLUTION_12B];
+}
+
+esp_err_t ds18b20_get_conversion_stats(ds18b20_device_handle_t ds18b20, ds18b20_conversion_stats_t *ret_stats)
+{
+    ESP_RETURN_ON_FALSE(ds18b20 && ret_stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    portENTER_CRITICAL(&s_devices_lock);
+    *ret_stats = ds18b20->conversion_stats;
+    portEXIT_CRITICAL(&s_devices_lock);
+    return ESP_OK;
+}
+
+esp_err_t ds18b20_trigger_temperature_conversion(ds18b20_device_handle_t ds18b20)
+{
+    ds18b20_conversion_t conversion = {};
+    ESP_RETURN_ON_ERROR(ds18b20_start_temperature_conversion(ds18b20, &conversion), TAG, "start conversion failed");
+    // delay proper time for temperature conversion
+    return ds18b20_finish_temperature_conversion(&conversion);
+}
+
+esp_err_t ds18b20_trigger_temperature_conversion_for_all(onewire_bus_handle_t bus)
+{
+    ds18b20_conversion_t conversion = {};
+    // devices may be configured with different resolutions, so wait for the slowest one
+    ESP_RETURN_ON_ERROR(ds18b20_start_temperature_conversion_for_all(bus, DS18B20_RESOLUTION_12B, &conversion),
+                        TAG, "start conversion failed");
+    return ds18b20_finish_temperature_conversion(&conversion);
+}
+
+esp_err_t ds18b20_get_temperature(ds18b20_device_handle_t ds18b20, float *ret_temperature)
+{
+    ESP_RETURN_ON_FALSE(ds18b20 && ret_temperature, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // send command: DS18B20_CMD_READ_SCRATCHPAD and read scratchpad data
+    ds18b20_scratchpad_t scratchpad;
+    ESP_RETURN_ON_ERROR(ds18b20_transaction(ds18b20, DS18B20_CMD_READ_SCRATCHPAD, NULL, 0, (uint8_t *)&scratchpad, sizeof(scratchpad)),
+                        TAG, "error while reading scratchpad data");
+    // check crc
+    ESP_RETURN_ON_FALSE(onewire_crc8(0, (uint8_t *)&scratchpad, 8) == scratchpad.crc_value, ESP_ERR_INVALID_CRC, TAG, "scratchpad crc error");
+
+    const uint8_t lsb_mask[4] = {0x07, 0x03, 0x01, 0x00}; // mask bits not used in low resolution
+    uint8_t lsb_masked = scratchpad.temp_lsb & (~lsb_mask[scratchpad.configuration >> 5]);
+    // Combine the MSB and masked LSB into a signed 16-bit integer
+    int16_t temperature_raw = (((int16_t)scratchpad.temp_msb << 8) | lsb_masked);
+    // Convert the raw temperature to a float,
+    *ret_temperature = temperature_raw / 16.0f;
+
+    return ESP_OK;
+}
@@ -0,0 +1,316 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include "esp_log.h"
+#include "unity.h"
+#include "unity_test_runner.h"
+#include "esp_timer.h"
+#include "onewire_bus.h"
+#include "onewire_device.h"
+#include "ds18b20.h"
+
+static const char *TAG = "test-app";
+
+// short conversions keep the tests fast, 12-bit takes this long and every bit less halves it
+#define TEST_CONVERSION_TIME_US 40000
+
+static onewire_bus_handle_t test_new_bus(const onewire_bus_sim_device_config_t *devices, size_t num_devices, uint32_t seed)
+{
+    onewire_bus_sim_config_t sim_config = {
+        .devices = devices,
+        .num_devices = num_devices,
+        .seed = seed,
+    };
+    onewire_bus_handle_t bus = NULL;
+    TEST_ESP_OK(onewire_new_bus_sim(&sim_config, &bus));
+    return bus;
+}
+
+// searches the bus, handles[i] belongs to devices[i] whatever order the search finds them in
+static void test_new_devices(onewire_bus_handle_t bus, const onewire_bus_sim_device_config_t *devices, size_t num_devices,
+                             ds18b20_device_handle_t *handles)
+{
+    onewire_device_iter_handle_t iter = NULL;
+    onewire_device_t dev;
+    size_t found = 0;
+    ds18b20_config_t ds_cfg = {};
+
+    TEST_ESP_OK(onewire_new_device_iter(bus, &iter));
+    while (onewire_device_iter_get_next(iter, &dev) == ESP_OK) {
+        for (size_t i = 0; i < num_devices; i++) {
+            // the simulator fills in the CRC byte of the ROM code
+            if ((dev.address & 0x00FFFFFFFFFFFFFFULL) == (devices[i].address & 0x00FFFFFFFFFFFFFFULL)) {
+                TEST_ESP_OK(ds18b20_new_device(&dev, &ds_cfg, &handles[i]));
+                found++;
+            }
+        }
+    }
+    TEST_ESP_OK(onewire_del_device_iter(iter));
+    TEST_ASSERT_EQUAL(num_devices, found);
+}
+
+static void test_convert_all(onewire_bus_handle_t bus, ds18b20_resolution_t resolution)
+{
+    ds18b20_conversion_t conversion = { .wait_mode = DS18B20_WAIT_MODE_POLL };
+    TEST_ESP_OK(ds18b20_start_temperature_conversion_for_all(bus, resolution, &conversion));
+    TEST_ESP_OK(ds18b20_finish_temperature_conversion(&conversion));
+}
+
+static void test_del(onewire_bus_handle_t bus, ds18b20_device_handle_t *handles, size_t num_devices)
+{
+    for (size_t i = 0; i < num_devices; i++) {
+        TEST_ESP_OK(ds18b20_del_device(handles[i]));
+    }
+    TEST_ESP_OK(onewire_bus_del(bus));
+}
+
+TEST_CASE("ds18b20 reads the temperature of every device", "[ds18b20]")
+{
+    const onewire_bus_sim_device_config_t devices[] = {
+        { .address = 0x0000000000A1B228, .temperature = 21.5f, .conversion_time_us = TEST_CONVERSION_TIME_US },
+        { .address = 0x0000000000C3D428, .temperature = -10.125f, .conversion_time_us = TEST_CONVERSION_TIME_US },
+    };
+    ds18b20_device_handle_t handles[2];
+    onewire_bus_handle_t bus = test_new_bus(devices, 2, 0);
+    test_new_devices(bus, devices, 2, handles);
+    float temperature = 0;
+
+    test_convert_all(bus, DS18B20_RESOLUTION_12B);
+    TEST_ESP_OK(ds18b20_get_temperature(handles[0], &temperature));
+    TEST_ASSERT_EQUAL_FLOAT(21.5f, temperature);
+    TEST_ESP_OK(ds18b20_get_temperature(handles[1], &temperature));
+    TEST_ASSERT_EQUAL_FLOAT(-10.125f, temperature);
+
+    // a new conversion picks up the new temperature, 9-bit drops everything below 0.5 C
+    TEST_ESP_OK(onewire_bus_sim_set_temperature(bus, 0, 23.3f));
+    TEST_ESP_OK(ds18b20_set_resolution(handles[0], DS18B20_RESOLUTION_9B));
+    test_convert_all(bus, DS18B20_RESOLUTION_12B);
+    TEST_ESP_OK(ds18b20_get_temperature(handles[0], &temperature));
+    TEST_ASSERT_EQUAL_FLOAT(23.0f, temperature);
+
+    test_del(bus, handles, 2);
+}
+
+TEST_CASE("ds18b20 conversion completes when the device releases the bus", "[ds18b20]")
+{
+    const onewire_bus_sim_device_config_t devices[] = {
+        { .address = 0x0000000000A1B228, .temperature = 25.0f, .conversion_time_us = TEST_CONVERSION_TIME_US },
+    };
+    ds18b20_device_handle_t handles[1];
+    onewire_bus_handle_t bus = test_new_bus(devices, 1, 0);
+    test_new_devices(bus, devices, 1, handles);
+
+    // polled: done once the device answers a read slot with 1, long before the 12-bit deadline
+    ds18b20_conversion_t conversion = { .wait_mode = DS18B20_WAIT_MODE_POLL };
+    TEST_ESP_OK(ds18b20_start_temperature_conversion(handles[0], &conversion));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FINISHED, ds18b20_poll_temperature_conversion(&conversion));
+    TEST_ESP_OK(ds18b20_finish_temperature_conversion(&conversion));
+    TEST_ASSERT_GREATER_OR_EQUAL(TEST_CONVERSION_TIME_US, conversion.elapsed_us);
+    TEST_ASSERT_LESS_THAN(conversion.deadline_us - conversion.start_us, conversion.elapsed_us);
+
+    ds18b20_conversion_stats_t stats;
+    TEST_ESP_OK(ds18b20_get_conversion_stats(handles[0], &stats));
+    TEST_ASSERT_EQUAL(1, stats.count);
+    TEST_ASSERT_EQUAL(conversion.elapsed_us, stats.last_us);
+
+    // every bit less halves the conversion time
+    TEST_ESP_OK(ds18b20_set_resolution(handles[0], DS18B20_RESOLUTION_9B));
+    conversion = (ds18b20_conversion_t) { .wait_mode = DS18B20_WAIT_MODE_POLL };
+    TEST_ESP_OK(ds18b20_start_temperature_conversion_for_all(bus, DS18B20_RESOLUTION_9B, &conversion));
+    TEST_ESP_OK(ds18b20_finish_temperature_conversion(&conversion));
+    TEST_ASSERT_GREATER_OR_EQUAL(TEST_CONVERSION_TIME_US / 8, conversion.elapsed_us);
+    TEST_ASSERT_LESS_THAN(TEST_CONVERSION_TIME_US, conversion.elapsed_us);
+    // a bus-wide conversion counts for every device on the bus
+    TEST_ESP_OK(ds18b20_get_conversion_stats(handles[0], &stats));
+    TEST_ASSERT_EQUAL(2, stats.count);
+    TEST_ASSERT_EQUAL(conversion.elapsed_us, stats.last_us);
+
+    // delayed: the full worst-case time is waited and nothing is measured
+    conversion = (ds18b20_conversion_t) { .wait_mode = DS18B20_WAIT_MODE_DELAY };
+    TEST_ESP_OK(ds18b20_start_temperature_conversion_for_all(bus, DS18B20_RESOLUTION_9B, &conversion));
+    TEST_ESP_OK(ds18b20_finish_temperature_conversion(&conversion));
+    TEST_ASSERT_TRUE(esp_timer_get_time() >= conversion.deadline_us);
+    TEST_ASSERT_EQUAL(0, conversion.elapsed_us);
+
+    test_del(bus, handles, 1);
+}
+
+TEST_CASE("ds18b20 reports corrupted scratchpads", "[ds18b20]")
+{
+    const onewire_bus_sim_device_config_t devices[] = {
+        { .address = 0x0000000000A1B228, .temperature = 19.75f, .conversion_time_us = TEST_CONVERSION_TIME_US, .crc_error_permille = 300 },
+    };
+    ds18b20_device_handle_t handles[1];
+    onewire_bus_handle_t bus = test_new_bus(devices, 1, 1234);
+    test_new_devices(bus, devices, 1, handles);
+    test_convert_all(bus, DS18B20_RESOLUTION_12B);
+
+    // a single flipped bit never slips through the CRC, and a good read is never rejected
+    uint32_t crc_errors = 0;
+    for (int i = 0; i < 100; i++) {
+        float temperature = 0;
+        esp_err_t err = ds18b20_get_temperature(handles[0], &temperature);
+        if (err == ESP_ERR_INVALID_CRC) {
+            crc_errors++;
+        } else {
+            TEST_ESP_OK(err);
+            TEST_ASSERT_EQUAL_FLOAT(19.75f, temperature);
+        }
+    }
+    onewire_bus_sim_stats_t stats;
+    TEST_ESP_OK(onewire_bus_sim_get_stats(bus, &stats));
+    TEST_ASSERT_GREATER_THAN(0, crc_errors);
+    TEST_ASSERT_EQUAL(stats.crc_errors_injected, crc_errors);
+
+    test_del(bus, handles, 1);
+}
+
+TEST_CASE("ds18b20 reports devices that drop off the bus", "[ds18b20]")
+{
+    const onewire_bus_sim_device_config_t devices[] = {
+        { .address = 0x0000000000A1B228, .temperature = 30.0f, .conversion_time_us = TEST_CONVERSION_TIME_US },
+        { .address = 0x0000000000C3D428, .temperature = 20.0f, .conversion_time_us = TEST_CONVERSION_TIME_US },
+    };
+    ds18b20_device_handle_t handles[2];
+    onewire_bus_handle_t bus = test_new_bus(devices, 2, 0);
+    test_new_devices(bus, devices, 2, handles);
+    test_convert_all(bus, DS18B20_RESOLUTION_12B);
+    float temperature = 0;
+
+    // with another device present, a silent one reads as all ones, which fails the CRC
+    TEST_ESP_OK(onewire_bus_sim_set_connected(bus, 0, false));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, ds18b20_get_temperature(handles[0], &temperature));
+    TEST_ESP_OK(ds18b20_get_temperature(handles[1], &temperature));
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, temperature);
+    TEST_ESP_OK(onewire_bus_sim_set_connected(bus, 0, true));
+    TEST_ESP_OK(ds18b20_get_temperature(handles[0], &temperature));
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, temperature);
+    test_del(bus, handles, 2);
+
+    // alone on the bus, nobody answers the reset pulse
+    const onewire_bus_sim_device_config_t flaky[] = {
+        { .address = 0x0000000000A1B228, .temperature = 30.0f, .conversion_time_us = TEST_CONVERSION_TIME_US, .dropout_permille = 300 },
+    };
+    bus = test_new_bus(flaky, 1, 1234);
+    ds18b20_config_t ds_cfg = {};
+    TEST_ESP_OK(ds18b20_new_single_device(bus, &ds_cfg, &handles[0]));
+    uint32_t dropouts = 0;
+    for (int i = 0; i < 100; i++) {
+        esp_err_t err = ds18b20_get_temperature(handles[0], &temperature);
+        if (err == ESP_ERR_NOT_FOUND) {
+            dropouts++;
+        } else {
+            TEST_ESP_OK(err);
+        }
+    }
+    onewire_bus_sim_stats_t stats;
+    TEST_ESP_OK(onewire_bus_sim_get_stats(bus, &stats));
+    TEST_ASSERT_GREATER_THAN(0, dropouts);
+    TEST_ASSERT_EQUAL(stats.dropouts_injected, dropouts);
+    test_del(bus, handles, 1);
+}
+
+TEST_CASE("ds18b20 alarm search finds only the devices out of their window", "[ds18b20]")
+{
+    const onewire_bus_sim_device_config_t devices[] = {
+        { .address = 0x0000000000A1B228, .temperature = 18.0f, .conversion_time_us = TEST_CONVERSION_TIME_US },
+        { .address = 0x0000000000C3D428, .temperature = 22.0f, .conversion_time_us = TEST_CONVERSION_TIME_US },
+        { .address = 0x0000000000E5F628, .temperature = 30.0f, .conversion_time_us = TEST_CONVERSION_TIME_US },
+    };
+    ds18b20_device_handle_t handles[3];
+    onewire_bus_handle_t bus = test_new_bus(devices, 3, 0);
+    test_new_devices(bus, devices, 3, handles);
+    for (int i = 0; i < 3; i++) {
+        TEST_ESP_OK(ds18b20_set_alarm_thresholds(handles[i], 25, 19));
+    }
+    test_convert_all(bus, DS18B20_RESOLUTION_12B);
+
+    onewire_device_iter_handle_t iter = NULL;
+    onewire_device_t dev;
+    int found[3] = {};
+    TEST_ESP_OK(onewire_new_device_iter(bus, &iter));
+    TEST_ESP_OK(onewire_device_iter_set_alarm_search(iter, true));
+    while (onewire_device_iter_get_next(iter, &dev) == ESP_OK) {
+        for (int i = 0; i < 3; i++) {
+            if ((dev.address & 0x00FFFFFFFFFFFFFFULL) == devices[i].address) {
+                found[i]++;
+            }
+        }
+    }
+    TEST_ESP_OK(onewire_del_device_iter(iter));
+    TEST_ASSERT_EQUAL(1, found[0]);
+    TEST_ASSERT_EQUAL(0, found[1]);
+    TEST_ASSERT_EQUAL(1, found[2]);
+
+    // back inside the window after the next conversion, nobody answers
+    TEST_ESP_OK(onewire_bus_sim_set_temperature(bus, 0, 21.0f));
+    TEST_ESP_OK(onewire_bus_sim_set_temperature(bus, 2, 24.9f));
+    test_convert_all(bus, DS18B20_RESOLUTION_12B);
+    TEST_ESP_OK(onewire_new_device_iter(bus, &iter));
+    TEST_ESP_OK(onewire_device_iter_set_alarm_search(iter, true));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, onewire_device_iter_get_next(iter, &dev));
+    TEST_ESP_OK(onewire_del_device_iter(iter));
+
+    test_del(bus, handles, 3);
+}
+
+TEST_CASE("rom search finds every device once, at a fixed cost per device", "[onewire]")
+{
+    // 16 DS18B20s with scattered serial numbers, and two devices of another family in between
+    onewire_bus_sim_device_config_t devices[18] = {};
+    for (int i = 0; i < 16; i++) {
+        devices[i].address = ((((uint64_t)i + 1) * 0xA5A5A5A5A5ULL) & 0xFFFFFFFFFFFFULL) << 8 | DS18B20_FAMILY_CODE;
+    }
+    devices[16].address = 0x0000000000123410;
+    devices[17].address = 0x0000000000567810;
+    onewire_bus_handle_t bus = test_new_bus(devices, 18, 0);
+    onewire_bus_sim_stats_t before, after;
+
+    for (int family_search = 0; family_search <= 1; family_search++) {
+        int expected = family_search ? 16 : 18;
+        int found[18] = {};
+        int total = 0;
+        onewire_device_iter_handle_t iter = NULL;
+        onewire_device_t dev;
+        TEST_ESP_OK(onewire_bus_sim_get_stats(bus, &before));
+        TEST_ESP_OK(onewire_new_device_iter(bus, &iter));
+        if (family_search) {
+            TEST_ESP_OK(onewire_device_iter_set_family(iter, DS18B20_FAMILY_CODE));
+        }
+        while (onewire_device_iter_get_next(iter, &dev) == ESP_OK) {
+            for (int i = 0; i < 18; i++) {
+                if ((dev.address & 0x00FFFFFFFFFFFFFFULL) == devices[i].address) {
+                    found[i]++;
+                }
+            }
+            total++;
+        }
+        TEST_ESP_OK(onewire_del_device_iter(iter));
+        TEST_ESP_OK(onewire_bus_sim_get_stats(bus, &after));
+
+        TEST_ASSERT_EQUAL(expected, total);
+        for (int i = 0; i < expected; i++) {
+            TEST_ASSERT_EQUAL(1, found[i]);
+        }
+        // one reset, the search command and 64 triplets per device: nothing is searched twice
+        uint32_t resets = after.resets - before.resets;
+        uint32_t slots = after.read_slots + after.write_slots - before.read_slots - before.write_slots;
+        ESP_LOGI(TAG, "%s search of %d device(s): %lu reset(s), %lu slot(s), %llu us on a real bus",
+                 family_search ? "family" : "full", expected, (unsigned long)resets, (unsigned long)slots,
+                 (unsigned long long)(after.bus_time_us - before.bus_time_us));
+        TEST_ASSERT_EQUAL(expected, resets);
+        TEST_ASSERT_EQUAL(expected * (8 + 64 * 3), slots);
+    }
+
+    TEST_ESP_OK(onewire_bus_del(bus));
+}
+
+void app_main(void)
+{
+    ESP_LOGI(TAG, "running the DS18B20 tests on a simulated bus");
+    UNITY_BEGIN();
+    unity_run_all_tests();
+    UNITY_END();
+}
@@ -0,0 +1,13 @@
+# SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+import pytest
+from pytest_embedded import Dut
+
+
+@pytest.mark.linux
+@pytest.mark.host_test
+def test_ds18b20_sim(dut: Dut) -> None:
+    dut.expect_exact('test-app: running the DS18B20 tests on a simulated bus')
+    dut.expect_exact('test-app: full search of 18 device(s): 18 reset(s)')
+    dut.expect_exact('test-app: family search of 16 device(s): 16 reset(s)')
+    dut.expect(r'\d+ Tests 0 Failures 0 Ignored', timeout=60)
@@ -9,6 +9,7 @@
 #include "esp_err.h"
 #include "onewire_types.h"
 #include "onewire_bus_impl_rmt.h"
+#include "onewire_bus_impl_sim.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -62,6 +63,24 @@ esp_err_t onewire_bus_write_bit(onewire_bus_handle_t bus, uint8_t tx_bit);
  */
 esp_err_t onewire_bus_read_bit(onewire_bus_handle_t bus, uint8_t *rx_bit);
 
+/**
+ * @brief Perform one ROM search step (the "triplet"): read a bit and its complement, then write the search direction
+ *
+ * @note If the participating devices agree on the bit, that bit is written back as the direction.
+ *       If they disagree, `preferred_direction` is written. If no device participates, 1 is written.
+ *
+ * @param[in] bus 1-Wire bus handle
+ * @param[in] preferred_direction direction to take if the participating devices disagree on this bit
+ * @param[out] id_bit received bit
+ * @param[out] cmp_id_bit received complement bit
+ * @param[out] taken_direction the direction that has been written to the bus
+ * @return
+ *      - ESP_OK: Perform the search step successfully
+ *      - ESP_ERR_INVALID_ARG: Perform the search step failed because of invalid argument
+ *      - ESP_FAIL: Perform the search step failed because of other errors
+ */
+esp_err_t onewire_bus_triplet(onewire_bus_handle_t bus, uint8_t preferred_direction, uint8_t *id_bit, uint8_t *cmp_id_bit, uint8_t *taken_direction);
+
 /**
  * @brief Send reset pulse to the bus, and check if there are devices attached to the bus
  *
@@ -74,6 +93,22 @@ esp_err_t onewire_bus_read_bit(onewire_bus_handle_t bus, uint8_t *rx_bit);
  */
 esp_err_t onewire_bus_reset(onewire_bus_handle_t bus);
 
+/**
+ * @brief Carry out a whole 1-Wire transaction: reset pulse, write phase and read phase
+ *
+ * @note Compared with calling `onewire_bus_reset`, `onewire_bus_write_bytes` and `onewire_bus_read_bytes` one by one,
+ *       the bus is locked only once and a backend can put all phases on the wire back to back.
+ *
+ * @param[in] bus 1-Wire bus handle
+ * @param[in] trans transaction to carry out
+ * @return
+ *      - ESP_OK: Carry out the transaction successfully
+ *      - ESP_ERR_INVALID_ARG: Carry out the transaction failed because of invalid argument
+ *      - ESP_ERR_NOT_FOUND: Carry out the transaction failed because no device answered the reset pulse
+ *      - ESP_FAIL: Carry out the transaction failed because of other errors
+ */
+esp_err_t onewire_bus_transaction(onewire_bus_handle_t bus, const onewire_bus_transaction_t *trans);
+
 /**
  * @brief Free 1-Wire bus resources
  *
@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "onewire_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Virtual DS18B20 attached to a simulated 1-Wire bus
+ */
+typedef struct {
+    onewire_device_address_t address; /*!< 64-bit ROM code, family code in the lowest byte.
+                                           If the highest byte (CRC) is 0, it's filled in by the simulator */
+    float temperature;                /*!< Temperature measured by the device, in degrees Celsius */
+    uint8_t th_user1;                 /*!< Initial content of the TH register */
+    uint8_t tl_user2;                 /*!< Initial content of the TL register */
+    uint8_t config;                   /*!< Initial content of the configuration register, 0 for the power-on default (12-bit) */
+    uint32_t conversion_time_us;      /*!< Conversion time at 12-bit resolution, halved for every bit less.
+                                           0 for the datasheet maximum (750 ms) */
+    uint32_t crc_error_permille;      /*!< Chance for a scratchpad read to come back with a flipped bit, in 1/1000 */
+    uint32_t dropout_permille;        /*!< Chance for the device to miss a reset pulse and stay silent until the next one, in 1/1000 */
+} onewire_bus_sim_device_config_t;
+
+/**
+ * @brief Simulated 1-Wire bus configuration
+ */
+typedef struct {
+    const onewire_bus_sim_device_config_t *devices; /*!< Devices attached to the bus, copied at creation */
+    size_t num_devices;                             /*!< Number of devices attached to the bus */
+    uint32_t seed;                                  /*!< Seed of the fault injection, the same seed gives the same faults */
+} onewire_bus_sim_config_t;
+
+/**
+ * @brief Traffic counters of a simulated 1-Wire bus
+ */
+typedef struct {
+    uint32_t resets;              /*!< Number of reset pulses */
+    uint32_t write_slots;         /*!< Number of write time slots */
+    uint32_t read_slots;          /*!< Number of read time slots */
+    uint64_t bus_time_us;         /*!< Time the same traffic takes on a real bus at standard speed, in microseconds */
+    uint32_t crc_errors_injected; /*!< Number of scratchpad reads that have been corrupted on purpose */
+    uint32_t dropouts_injected;   /*!< Number of reset pulses a device has missed on purpose */
+} onewire_bus_sim_stats_t;
+
+/**
+ * @brief Create 1-Wire bus with a software backend that models DS18B20 devices
+ *
+ * @note Only built with CONFIG_ONEWIRE_BUS_SIM, which is on by default for the linux target only.
+ * @note The devices are modelled at the time slot level (ROM commands, Search ROM, Alarm Search, Convert T,
+ *       Read/Write Scratchpad), so the bus can be used on targets without 1-Wire hardware, e.g. the linux target.
+ *
+ * @param[in] sim_config Simulated bus configuration
+ * @param[out] ret_bus Returned 1-Wire bus handle
+ * @return
+ *      - ESP_OK: create 1-Wire bus handle successfully
+ *      - ESP_ERR_INVALID_ARG: create 1-Wire bus handle failed because of invalid argument
+ *      - ESP_ERR_NO_MEM: create 1-Wire bus handle failed because of out of memory
+ */
+esp_err_t onewire_new_bus_sim(const onewire_bus_sim_config_t *sim_config, onewire_bus_handle_t *ret_bus);
+
+/**
+ * @brief Change the temperature measured by a simulated device, used by its next conversion
+ *
+ * @param[in] bus 1-Wire bus handle returned by `onewire_new_bus_sim`
+ * @param[in] index index of the device in `onewire_bus_sim_config_t::devices`
+ * @param[in] temperature new temperature, in degrees Celsius
+ * @return
+ *      - ESP_OK: Set temperature successfully
+ *      - ESP_ERR_INVALID_ARG: Set temperature failed because of invalid argument
+ */
+esp_err_t onewire_bus_sim_set_temperature(onewire_bus_handle_t bus, size_t index, float temperature);
+
+/**
+ * @brief Plug a simulated device in or out, a disconnected device keeps its scratchpad
+ *
+ * @param[in] bus 1-Wire bus handle returned by `onewire_new_bus_sim`
+ * @param[in] index index of the device in `onewire_bus_sim_config_t::devices`
+ * @param[in] connected false to make the device ignore the bus
+ * @return
+ *      - ESP_OK: Set connection state successfully
+ *      - ESP_ERR_INVALID_ARG: Set connection state failed because of invalid argument
+ */
+esp_err_t onewire_bus_sim_set_connected(onewire_bus_handle_t bus, size_t index, bool connected);
+
+/**
+ * @brief Get the traffic counters of a simulated bus
+ *
+ * @param[in] bus 1-Wire bus handle returned by `onewire_new_bus_sim`
+ * @param[out] stats returned counters
+ * @return
+ *      - ESP_OK: Get counters successfully
+ *      - ESP_ERR_INVALID_ARG: Get counters failed because of invalid argument
+ */
+esp_err_t onewire_bus_sim_get_stats(onewire_bus_handle_t bus, onewire_bus_sim_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
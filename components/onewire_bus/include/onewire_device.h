@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "esp_err.h"
 #include "onewire_types.h"
 
@@ -45,6 +46,35 @@ esp_err_t onewire_new_device_iter(onewire_bus_handle_t bus, onewire_device_iter_
  */
 esp_err_t onewire_del_device_iter(onewire_device_iter_handle_t iter);
 
+/**
+ * @brief Restrict the device iterator to devices of one family (targeted search)
+ *
+ * @note The search jumps straight to the first device of the family and stops as soon as it would leave the family,
+ *       so devices of other families on the bus cost nothing.
+ *       This function must be called before the first `onewire_device_iter_get_next`.
+ *
+ * @param[in] iter Device iterator handle
+ * @param[in] family_code Family code, the lowest byte of the ROM number (e.g. 0x28 for DS18B20)
+ * @return
+ *      - ESP_OK: Set family successfully
+ *      - ESP_ERR_INVALID_ARG: Invalid argument
+ */
+esp_err_t onewire_device_iter_set_family(onewire_device_iter_handle_t iter, uint8_t family_code);
+
+/**
+ * @brief Make the device iterator only enumerate devices whose alarm flag is set (alarm search)
+ *
+ * @note This function must be called before the first `onewire_device_iter_get_next`.
+ *       It can be combined with `onewire_device_iter_set_family`.
+ *
+ * @param[in] iter Device iterator handle
+ * @param[in] en_alarm_search true to use the Alarm Search command instead of the normal Search ROM command
+ * @return
+ *      - ESP_OK: Set alarm search successfully
+ *      - ESP_ERR_INVALID_ARG: Invalid argument
+ */
+esp_err_t onewire_device_iter_set_alarm_search(onewire_device_iter_handle_t iter, bool en_alarm_search);
+
 /**
  * @brief Get the next 1-Wire device from the iterator
  *
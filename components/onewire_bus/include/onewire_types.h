@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +39,19 @@ typedef struct {
     } flags; /*!< Configuration flags for the bus */
 } onewire_bus_config_t;
 
+/**
+ * @brief 1-Wire transaction: a reset pulse, bytes to write, then bytes to read, all carried out in one go
+ */
+typedef struct {
+    const uint8_t *tx_data; /*!< Bytes to write after the reset, e.g. ROM command + ROM number + function command */
+    size_t tx_data_size;    /*!< Number of bytes to write, can be 0 */
+    uint8_t *rx_buf;        /*!< Buffer to store the bytes read after the write phase */
+    size_t rx_buf_size;     /*!< Number of bytes to read, can be 0 */
+    struct onewire_bus_transaction_flags {
+        uint32_t no_reset: 1; /*!< Set to skip the reset pulse at the beginning of the transaction */
+    } flags; /*!< Transaction flags */
+} onewire_bus_transaction_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include "esp_err.h"
+#include "onewire_types.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -68,6 +69,23 @@ struct onewire_bus_t {
      */
     esp_err_t (*read_bit)(onewire_bus_handle_t handle, uint8_t *rx_bit);
 
+    /**
+     * @brief Perform one ROM search step: read a bit and its complement, then write the search direction
+     *
+     * @note This is an optional function, the bus API falls back to `read_bit` and `write_bit` if it's NULL
+     *
+     * @param[in] bus 1-Wire bus handle
+     * @param[in] preferred_direction direction to take if the participating devices disagree on this bit
+     * @param[out] id_bit received bit
+     * @param[out] cmp_id_bit received complement bit
+     * @param[out] taken_direction the direction that has been written to the bus
+     * @return
+     *      - ESP_OK: Perform the search step successfully
+     *      - ESP_ERR_INVALID_ARG: Perform the search step failed because of invalid argument
+     *      - ESP_FAIL: Perform the search step failed because of other errors
+     */
+    esp_err_t (*triplet)(onewire_bus_t *bus, uint8_t preferred_direction, uint8_t *id_bit, uint8_t *cmp_id_bit, uint8_t *taken_direction);
+
     /**
      * @brief Send reset pulse to the bus, and check if there are devices attached to the bus
      *
@@ -80,6 +98,21 @@ struct onewire_bus_t {
      */
     esp_err_t (*reset)(onewire_bus_t *bus);
 
+    /**
+     * @brief Carry out a whole transaction: reset, write phase and read phase
+     *
+     * @note This is an optional function, the bus API falls back to `reset`, `write_bytes` and `read_bytes` if it's NULL
+     *
+     * @param[in] bus 1-Wire bus handle
+     * @param[in] trans transaction to carry out
+     * @return
+     *      - ESP_OK: Carry out the transaction successfully
+     *      - ESP_ERR_INVALID_ARG: Carry out the transaction failed because of invalid argument
+     *      - ESP_ERR_NOT_FOUND: Carry out the transaction failed because no device answered the reset pulse
+     *      - ESP_FAIL: Carry out the transaction failed because of other errors
+     */
+    esp_err_t (*transaction)(onewire_bus_t *bus, const onewire_bus_transaction_t *trans);
+
     /**
      * @brief Free 1-Wire bus resources
      *
@@ -92,6 +125,25 @@ struct onewire_bus_t {
     esp_err_t (*del)(onewire_bus_t *bus);
 };
 
+/**
+ * @brief Decide which direction a ROM search step takes, helper for backends that implement `triplet`
+ *
+ * @param[in] id_bit received bit
+ * @param[in] cmp_id_bit received complement bit
+ * @param[in] preferred_direction direction to take if the participating devices disagree on this bit
+ * @return direction to write to the bus
+ */
+static inline uint8_t onewire_bus_triplet_direction(uint8_t id_bit, uint8_t cmp_id_bit, uint8_t preferred_direction)
+{
+    if (id_bit != cmp_id_bit) { // all participating devices agree on this bit
+        return id_bit;
+    }
+    if (id_bit == 0) { // discrepancy, both 0s and 1s are present
+        return preferred_direction ? 0x01 : 0x00;
+    }
+    return 0x01; // no device participating, just release the bus
+}
+
 #ifdef __cplusplus
 }
 #endif
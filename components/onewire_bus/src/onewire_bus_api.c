@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "esp_log.h"
+#include "esp_check.h"
+#include "onewire_types.h"
+#include "onewire_bus_interface.h"
+
+static const char *TAG = "1-wire";
+
+esp_err_t onewire_bus_reset(onewire_bus_handle_t bus)
+{
+    ESP_RETURN_ON_FALSE(bus, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return bus->reset(bus);
+}
+
+esp_err_t onewire_bus_transaction(onewire_bus_handle_t bus, const onewire_bus_transaction_t *trans)
+{
+    ESP_RETURN_ON_FALSE(bus && trans, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE((trans->tx_data || !trans->tx_data_size) && (trans->rx_buf || !trans->rx_buf_size),
+                        ESP_ERR_INVALID_ARG, TAG, "invalid transaction buffer");
+    if (bus->transaction) {
+        return bus->transaction(bus, trans);
+    }
+
+    // generic implementation for backends without a dedicated transaction
+    ESP_RETURN_ON_FALSE(trans->tx_data_size <= UINT8_MAX, ESP_ERR_INVALID_ARG, TAG, "tx_data_size too large");
+    if (!trans->flags.no_reset) {
+        ESP_RETURN_ON_ERROR(bus->reset(bus), TAG, "reset bus error");
+    }
+    if (trans->tx_data_size) {
+        ESP_RETURN_ON_ERROR(bus->write_bytes(bus, trans->tx_data, (uint8_t)trans->tx_data_size), TAG, "write bytes error");
+    }
+    if (trans->rx_buf_size) {
+        ESP_RETURN_ON_ERROR(bus->read_bytes(bus, trans->rx_buf, trans->rx_buf_size), TAG, "read bytes error");
+    }
+    return ESP_OK;
+}
+
+esp_err_t onewire_bus_write_bytes(onewire_bus_handle_t bus, const uint8_t *tx_data, uint8_t tx_data_size)
+{
+    ESP_RETURN_ON_FALSE(bus && tx_data && tx_data_size, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return bus->write_bytes(bus, tx_data, tx_data_size);
+}
+
+esp_err_t onewire_bus_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size)
+{
+    ESP_RETURN_ON_FALSE(bus && rx_buf && rx_buf_size, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return bus->read_bytes(bus, rx_buf, rx_buf_size);
+}
+
+esp_err_t onewire_bus_write_bit(onewire_bus_handle_t bus, uint8_t tx_bit)
+{
+    ESP_RETURN_ON_FALSE(bus, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return bus->write_bit(bus, tx_bit);
+}
+
+esp_err_t onewire_bus_read_bit(onewire_bus_handle_t bus, uint8_t *rx_bit)
+{
+    ESP_RETURN_ON_FALSE(bus && rx_bit, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return bus->read_bit(bus, rx_bit);
+}
+
+esp_err_t onewire_bus_triplet(onewire_bus_handle_t bus, uint8_t preferred_direction, uint8_t *id_bit, uint8_t *cmp_id_bit, uint8_t *taken_direction)
+{
+    ESP_RETURN_ON_FALSE(bus && id_bit && cmp_id_bit && taken_direction, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (bus->triplet) {
+        return bus->triplet(bus, preferred_direction, id_bit, cmp_id_bit, taken_direction);
+    }
+
+    // generic implementation for backends without a dedicated triplet
+    ESP_RETURN_ON_ERROR(bus->read_bit(bus, id_bit), TAG, "read id_bit error");
+    ESP_RETURN_ON_ERROR(bus->read_bit(bus, cmp_id_bit), TAG, "read cmp_id_bit error");
+    *taken_direction = onewire_bus_triplet_direction(*id_bit, *cmp_id_bit, preferred_direction);
+    return bus->write_bit(bus, *taken_direction);
+}
+
+esp_err_t onewire_bus_del(onewire_bus_handle_t bus)
+{
+    ESP_RETURN_ON_FALSE(bus, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return bus->del(bus);
+}
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <string.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -30,12 +31,19 @@ static const char *TAG = "1-wire.rmt";
 #define ONEWIRE_RMT_DEFAULT_MEM_BLOCK_SYMBOLS   48
 #endif
 
+// a transaction is captured in one go: up to 2 symbols for the reset pulse, then one RMT symbol per written or read bit
+#define ONEWIRE_RMT_TRANS_SYMBOLS(tx_bytes, rx_bytes)   (2 + ((tx_bytes) + (rx_bytes)) * 8)
+#define ONEWIRE_RMT_MAX_TRANS_TX_BYTES          16 // ROM command + 8byte ROM number + function command + some payload
+
 // for chips whose RMT RX channel doesn't support ping-pong, we need the user to tell the maximum number of bytes will be received
 #if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
 // one RMT symbol represents one bit, so x8
 #define ONEWIRE_RMT_RX_MEM_BLOCK_SIZE           (rmt_config->max_rx_bytes * 8)
+// a single capture can't be larger than the memory block
+#define ONEWIRE_RMT_MAX_TRANS_SYMBOLS           ONEWIRE_RMT_RX_MEM_BLOCK_SIZE
 #else // otherwise, we just use one memory block, to save resources
 #define ONEWIRE_RMT_RX_MEM_BLOCK_SIZE           ONEWIRE_RMT_DEFAULT_MEM_BLOCK_SYMBOLS
+#define ONEWIRE_RMT_MAX_TRANS_SYMBOLS           ONEWIRE_RMT_TRANS_SYMBOLS(ONEWIRE_RMT_MAX_TRANS_TX_BYTES, rmt_config->max_rx_bytes)
 #endif
 
 /*
@@ -57,6 +65,7 @@ Reset Pulse:
 #define ONEWIRE_RESET_WAIT_DURATION             200 // how long should master wait for device to show its presence
 #define ONEWIRE_RESET_PRESENCE_WAIT_DURATION_MIN 15 // minimum duration for master to wait device to show its presence
 #define ONEWIRE_RESET_PRESENCE_DURATION_MIN      60 // minimum duration for master to recognize device as present
+#define ONEWIRE_RESET_RECOVERY_DURATION         500 // tRSTH: at least 480us from releasing the bus to the first slot
 
 /*
 Write 1 bit:
@@ -125,6 +134,7 @@ typedef struct {
     rmt_symbol_word_t *rx_symbols_buf; /*!< hold rmt raw symbols */
 
     size_t max_rx_bytes; /*!< buffer size in byte for single receive transaction */
+    size_t max_trans_symbols; /*!< how many RMT symbols a whole transaction may take to be captured in one go */
 
     QueueHandle_t receive_queue;
     SemaphoreHandle_t bus_mutex;
@@ -137,6 +147,14 @@ static rmt_symbol_word_t onewire_reset_pulse_symbol = {
     .duration1 = ONEWIRE_RESET_WAIT_DURATION
 };
 
+// reset pulse of a batched transaction: the next slot follows right behind it, so it also covers tRSTH
+static rmt_symbol_word_t onewire_transaction_reset_symbol = {
+    .level0 = 0,
+    .duration0 = ONEWIRE_RESET_PULSE_DURATION,
+    .level1 = 1,
+    .duration1 = ONEWIRE_RESET_RECOVERY_DURATION
+};
+
 static rmt_symbol_word_t onewire_bit0_symbol = {
     .level0 = 0,
     .duration0 = ONEWIRE_SLOT_START_DURATION + ONEWIRE_SLOT_BIT_DURATION,
@@ -151,6 +169,22 @@ static rmt_symbol_word_t onewire_bit1_symbol = {
     .duration1 = ONEWIRE_SLOT_BIT_DURATION + ONEWIRE_SLOT_RECOVERY_DURATION
 };
 
+// two read slots back to back, used by the ROM search triplet
+static rmt_symbol_word_t onewire_read_2bits_symbols[2] = {
+    {
+        .level0 = 0,
+        .duration0 = ONEWIRE_SLOT_START_DURATION,
+        .level1 = 1,
+        .duration1 = ONEWIRE_SLOT_BIT_DURATION + ONEWIRE_SLOT_RECOVERY_DURATION
+    },
+    {
+        .level0 = 0,
+        .duration0 = ONEWIRE_SLOT_START_DURATION,
+        .level1 = 1,
+        .duration1 = ONEWIRE_SLOT_BIT_DURATION + ONEWIRE_SLOT_RECOVERY_DURATION
+    },
+};
+
 const static rmt_transmit_config_t onewire_rmt_tx_config = {
     .loop_count = 0,     // no transfer loop
     .flags.eot_level = 1 // onewire bus should be released in IDLE
@@ -165,7 +199,9 @@ static esp_err_t onewire_bus_rmt_read_bit(onewire_bus_handle_t bus, uint8_t *rx_
 static esp_err_t onewire_bus_rmt_write_bit(onewire_bus_handle_t bus, uint8_t tx_bit);
 static esp_err_t onewire_bus_rmt_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size);
 static esp_err_t onewire_bus_rmt_write_bytes(onewire_bus_handle_t bus, const uint8_t *tx_data, uint8_t tx_data_size);
+static esp_err_t onewire_bus_rmt_triplet(onewire_bus_handle_t bus, uint8_t preferred_direction, uint8_t *id_bit, uint8_t *cmp_id_bit, uint8_t *taken_direction);
 static esp_err_t onewire_bus_rmt_reset(onewire_bus_handle_t bus);
+static esp_err_t onewire_bus_rmt_transaction(onewire_bus_handle_t bus, const onewire_bus_transaction_t *trans);
 static esp_err_t onewire_bus_rmt_del(onewire_bus_handle_t bus);
 static esp_err_t onewire_bus_rmt_destroy(onewire_bus_rmt_obj_t *bus_rmt);
 
@@ -312,8 +348,9 @@ esp_err_t onewire_new_bus_rmt(const onewire_bus_config_t *bus_config, const onew
         gpio_set_pull_mode(bus_rmt->data_gpio_num, GPIO_FLOATING);
     }
 
-    // allocate rmt rx symbol buffer, one RMT symbol represents one bit, so x8
-    bus_rmt->rx_symbols_buf = malloc(rmt_config->max_rx_bytes * sizeof(rmt_symbol_word_t) * 8);
+    // allocate rmt rx symbol buffer, big enough to capture a whole transaction
+    bus_rmt->max_trans_symbols = ONEWIRE_RMT_MAX_TRANS_SYMBOLS;
+    bus_rmt->rx_symbols_buf = malloc(MAX(bus_rmt->max_trans_symbols, rmt_config->max_rx_bytes * 8) * sizeof(rmt_symbol_word_t));
     ESP_GOTO_ON_FALSE(bus_rmt->rx_symbols_buf, ESP_ERR_NO_MEM, err, TAG, "no mem to store received RMT symbols");
     bus_rmt->max_rx_bytes = rmt_config->max_rx_bytes;
 
@@ -350,6 +387,8 @@ esp_err_t onewire_new_bus_rmt(const onewire_bus_config_t *bus_config, const onew
     bus_rmt->base.write_bytes = onewire_bus_rmt_write_bytes;
     bus_rmt->base.read_bit = onewire_bus_rmt_read_bit;
     bus_rmt->base.read_bytes = onewire_bus_rmt_read_bytes;
+    bus_rmt->base.triplet = onewire_bus_rmt_triplet;
+    bus_rmt->base.transaction = onewire_bus_rmt_transaction;
     *ret_bus = &bus_rmt->base;
 
     return ret;
@@ -519,3 +558,120 @@ err:
     xSemaphoreGive(bus_rmt->bus_mutex);
     return ret;
 }
+
+// Both read slots go out in one transmission and are captured by one receive,
+// only the direction bit needs a second transmission, and all of it happens under one lock.
+static esp_err_t onewire_bus_rmt_triplet(onewire_bus_handle_t bus, uint8_t preferred_direction, uint8_t *id_bit, uint8_t *cmp_id_bit, uint8_t *taken_direction)
+{
+    onewire_bus_rmt_obj_t *bus_rmt = __containerof(bus, onewire_bus_rmt_obj_t, base);
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(bus_rmt->bus_mutex, portMAX_DELAY);
+
+    // transmit 2 bits while receiving
+    ESP_GOTO_ON_ERROR(rmt_receive(bus_rmt->rx_channel, bus_rmt->rx_symbols_buf, sizeof(onewire_read_2bits_symbols), &onewire_rmt_rx_config),
+                      err, TAG, "1-wire triplet receive failed");
+    ESP_GOTO_ON_ERROR(rmt_transmit(bus_rmt->tx_channel, bus_rmt->tx_copy_encoder, onewire_read_2bits_symbols, sizeof(onewire_read_2bits_symbols), &onewire_rmt_tx_config),
+                      err, TAG, "1-wire triplet transmit failed");
+
+    // wait the transmission finishes and decode data
+    rmt_rx_done_event_data_t rmt_rx_evt_data;
+    ESP_GOTO_ON_FALSE(xQueueReceive(bus_rmt->receive_queue, &rmt_rx_evt_data, pdMS_TO_TICKS(1000)) == pdPASS, ESP_ERR_TIMEOUT,
+                      err, TAG, "1-wire triplet receive timeout");
+    uint8_t rx_buffer = 0;
+    onewire_rmt_decode_data(rmt_rx_evt_data.received_symbols, rmt_rx_evt_data.num_symbols, &rx_buffer, sizeof(rx_buffer));
+    *id_bit = rx_buffer & 0x01;
+    *cmp_id_bit = (rx_buffer >> 1) & 0x01;
+    *taken_direction = onewire_bus_triplet_direction(*id_bit, *cmp_id_bit, preferred_direction);
+
+    // transmit the direction bit
+    const rmt_symbol_word_t *symbol_to_transmit = *taken_direction ? &onewire_bit1_symbol : &onewire_bit0_symbol;
+    ESP_GOTO_ON_ERROR(rmt_transmit(bus_rmt->tx_channel, bus_rmt->tx_copy_encoder, symbol_to_transmit, sizeof(rmt_symbol_word_t), &onewire_rmt_tx_config),
+                      err, TAG, "1-wire triplet direction transmit failed");
+    // the next receive must not capture this slot, so wait the transmission to complete
+    ESP_GOTO_ON_ERROR(rmt_tx_wait_all_done(bus_rmt->tx_channel, 50), err, TAG, "wait for 1-wire triplet direction transmit failed");
+
+err:
+    xSemaphoreGive(bus_rmt->bus_mutex);
+    return ret;
+}
+
+static esp_err_t onewire_bus_rmt_transaction_by_phase(onewire_bus_handle_t bus, const onewire_bus_transaction_t *trans)
+{
+    ESP_RETURN_ON_FALSE(trans->tx_data_size <= UINT8_MAX, ESP_ERR_INVALID_ARG, TAG, "tx_data_size too large");
+    if (!trans->flags.no_reset) {
+        ESP_RETURN_ON_ERROR(onewire_bus_rmt_reset(bus), TAG, "reset bus error");
+    }
+    if (trans->tx_data_size) {
+        ESP_RETURN_ON_ERROR(onewire_bus_rmt_write_bytes(bus, trans->tx_data, (uint8_t)trans->tx_data_size), TAG, "write bytes error");
+    }
+    if (trans->rx_buf_size) {
+        ESP_RETURN_ON_ERROR(onewire_bus_rmt_read_bytes(bus, trans->rx_buf, trans->rx_buf_size), TAG, "read bytes error");
+    }
+    return ESP_OK;
+}
+
+// The reset pulse, the written bytes and the read clock are queued as back-to-back transmissions (they fit in the
+// transmit queue), while one receive captures the whole transaction. So the task only wakes up once, when it's all done.
+static esp_err_t onewire_bus_rmt_transaction(onewire_bus_handle_t bus, const onewire_bus_transaction_t *trans)
+{
+    onewire_bus_rmt_obj_t *bus_rmt = __containerof(bus, onewire_bus_rmt_obj_t, base);
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(trans->rx_buf_size <= bus_rmt->max_rx_bytes, ESP_ERR_INVALID_ARG, TAG, "rx_buf_size too large for buffer to hold");
+
+    size_t data_symbols = (trans->tx_data_size + trans->rx_buf_size) * 8;
+    size_t trans_symbols = data_symbols + (trans->flags.no_reset ? 0 : 2);
+    if (data_symbols == 0 || trans_symbols > bus_rmt->max_trans_symbols) {
+        // nothing worth batching, or the capture doesn't fit, carry out the phases one by one
+        return onewire_bus_rmt_transaction_by_phase(bus, trans);
+    }
+
+    // transmit one bits to generate read clock
+    uint8_t tx_buffer[trans->rx_buf_size ? trans->rx_buf_size : 1];
+    memset(tx_buffer, 0xFF, sizeof(tx_buffer));
+    if (trans->rx_buf_size) {
+        memset(trans->rx_buf, 0, trans->rx_buf_size);
+    }
+
+    xSemaphoreTake(bus_rmt->bus_mutex, portMAX_DELAY);
+
+    ESP_GOTO_ON_ERROR(rmt_receive(bus_rmt->rx_channel, bus_rmt->rx_symbols_buf, trans_symbols * sizeof(rmt_symbol_word_t), &onewire_rmt_rx_config),
+                      err, TAG, "1-wire transaction receive failed");
+    if (!trans->flags.no_reset) {
+        ESP_GOTO_ON_ERROR(rmt_transmit(bus_rmt->tx_channel, bus_rmt->tx_copy_encoder, &onewire_transaction_reset_symbol, sizeof(onewire_transaction_reset_symbol), &onewire_rmt_tx_config),
+                          err, TAG, "1-wire reset pulse transmit failed");
+    }
+    if (trans->tx_data_size) {
+        ESP_GOTO_ON_ERROR(rmt_transmit(bus_rmt->tx_channel, bus_rmt->tx_bytes_encoder, trans->tx_data, trans->tx_data_size, &onewire_rmt_tx_config),
+                          err, TAG, "1-wire data transmit failed");
+    }
+    if (trans->rx_buf_size) {
+        ESP_GOTO_ON_ERROR(rmt_transmit(bus_rmt->tx_channel, bus_rmt->tx_bytes_encoder, tx_buffer, trans->rx_buf_size, &onewire_rmt_tx_config),
+                          err, TAG, "1-wire read clock transmit failed");
+    }
+
+    // wait the whole transaction finishes
+    rmt_rx_done_event_data_t rmt_rx_evt_data;
+    ESP_GOTO_ON_FALSE(xQueueReceive(bus_rmt->receive_queue, &rmt_rx_evt_data, pdMS_TO_TICKS(1000)) == pdPASS, ESP_ERR_TIMEOUT,
+                      err, TAG, "1-wire transaction receive timeout");
+
+    // every bit slot is one symbol, so what comes before them is the reset pulse, 2 symbols with presence pulse, 1 without
+    size_t symbol_num = rmt_rx_evt_data.num_symbols;
+    ESP_GOTO_ON_FALSE(symbol_num >= data_symbols, ESP_FAIL, err, TAG, "1-wire transaction captured too few symbols");
+    if (!trans->flags.no_reset) {
+        if (symbol_num < data_symbols + 2 ||
+                onewire_rmt_check_presence_pulse(rmt_rx_evt_data.received_symbols, symbol_num - data_symbols) == false) {
+            ret = ESP_ERR_NOT_FOUND;
+            goto err;
+        }
+    }
+    // the read slots are the last ones
+    if (trans->rx_buf_size) {
+        onewire_rmt_decode_data(&rmt_rx_evt_data.received_symbols[symbol_num - trans->rx_buf_size * 8], trans->rx_buf_size * 8,
+                                trans->rx_buf, trans->rx_buf_size);
+    }
+
+err:
+    xSemaphoreGive(bus_rmt->bus_mutex);
+    return ret;
+}
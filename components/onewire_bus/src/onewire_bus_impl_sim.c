@@ -0,0 +1,545 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "onewire_bus_impl_sim.h"
+#include "onewire_bus_interface.h"
+#include "onewire_cmd.h"
+#include "onewire_crc.h"
+
+static const char *TAG = "1-wire.sim";
+
+// time the traffic would take on a real bus, same timing as the RMT backend
+#define ONEWIRE_SIM_RESET_DURATION      (500 + 200) // reset pulse + presence wait
+#define ONEWIRE_SIM_SLOT_DURATION       (2 + 60 + 5) // slot start + bit + recovery
+
+#define ONEWIRE_SIM_DEFAULT_CONVERSION_TIME_US 750000 // DS18B20 maximum conversion time at 12-bit
+
+// DS18B20 function commands
+#define DS18B20_SIM_CMD_CONVERT_TEMP      0x44
+#define DS18B20_SIM_CMD_WRITE_SCRATCHPAD  0x4E
+#define DS18B20_SIM_CMD_READ_SCRATCHPAD   0xBE
+#define DS18B20_SIM_CMD_COPY_SCRATCHPAD   0x48
+#define DS18B20_SIM_CMD_RECALL_EEPROM     0xB8
+#define ONEWIRE_SIM_CMD_READ_ROM          0x33
+
+#define DS18B20_SIM_SCRATCHPAD_SIZE 9
+
+typedef enum {
+    SIM_STATE_IDLE,           // not selected, waits for the next reset pulse
+    SIM_STATE_ROM_CMD,        // receiving the ROM command
+    SIM_STATE_SEARCH,         // taking part in Search ROM or Alarm Search
+    SIM_STATE_MATCH_ROM,      // receiving the ROM number of Match ROM
+    SIM_STATE_FUNC_CMD,       // selected, receiving the function command
+    SIM_STATE_WRITE_SCRATCHPAD, // receiving TH, TL and configuration
+    SIM_STATE_TRANSMIT,       // sending tx_buf, then releases the bus
+    SIM_STATE_CONVERTING,     // answering read slots with the conversion status
+} onewire_sim_state_t;
+
+typedef struct {
+    onewire_bus_sim_device_config_t config;
+    bool connected;
+    onewire_sim_state_t state;
+    uint8_t rx_byte;          // bits received so far, LSB first
+    int bit_index;            // bit position within the current state
+    int search_phase;         // 0: send bit, 1: send complement, 2: receive direction
+    uint8_t tx_buf[DS18B20_SIM_SCRATCHPAD_SIZE];
+    int tx_bits;
+    uint8_t scratchpad[DS18B20_SIM_SCRATCHPAD_SIZE];
+    uint8_t eeprom[3];        // TH, TL, configuration
+    bool converting;
+    int64_t conversion_end_us;
+    bool alarm;
+} onewire_sim_device_t;
+
+typedef struct {
+    onewire_bus_t base; /*!< base class */
+    onewire_sim_device_t *devices;
+    size_t num_devices;
+    uint32_t rng_state;
+    onewire_bus_sim_stats_t stats;
+    SemaphoreHandle_t bus_mutex;
+} onewire_bus_sim_obj_t;
+
+static esp_err_t onewire_bus_sim_del(onewire_bus_handle_t bus);
+
+static uint32_t onewire_sim_random(onewire_bus_sim_obj_t *bus_sim)
+{
+    // xorshift32
+    uint32_t x = bus_sim->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bus_sim->rng_state = x;
+    return x;
+}
+
+static bool onewire_sim_chance(onewire_bus_sim_obj_t *bus_sim, uint32_t permille)
+{
+    return permille && (onewire_sim_random(bus_sim) % 1000) < permille;
+}
+
+static inline uint8_t onewire_sim_rom_bit(const onewire_sim_device_t *dev, int bit)
+{
+    return (dev->config.address >> bit) & 0x01;
+}
+
+static void onewire_sim_update_crc(onewire_sim_device_t *dev)
+{
+    dev->scratchpad[8] = onewire_crc8(0, dev->scratchpad, 8);
+}
+
+// the conversion runs on its own, whatever happens on the bus, the result is latched when it ends
+static void onewire_sim_update_conversion(onewire_sim_device_t *dev)
+{
+    if (!dev->converting || esp_timer_get_time() < dev->conversion_end_us) {
+        return;
+    }
+    dev->converting = false;
+
+    float temperature = fminf(fmaxf(dev->config.temperature, -55.0f), 125.0f);
+    int16_t raw = (int16_t)lroundf(temperature * 16.0f);
+    int resolution = (dev->scratchpad[4] >> 5) & 0x03;
+    raw &= ~((1 << (3 - resolution)) - 1); // undefined bits read as 0
+    dev->scratchpad[0] = raw & 0xFF;
+    dev->scratchpad[1] = (raw >> 8) & 0xFF;
+    onewire_sim_update_crc(dev);
+
+    // only the integer part is compared with TH and TL
+    int8_t integer = (int8_t)(raw >> 4);
+    dev->alarm = integer >= (int8_t)dev->scratchpad[2] || integer <= (int8_t)dev->scratchpad[3];
+}
+
+static void onewire_sim_start_transmit(onewire_sim_device_t *dev, const uint8_t *data, size_t size)
+{
+    memcpy(dev->tx_buf, data, size);
+    dev->tx_bits = size * 8;
+    dev->bit_index = 0;
+    dev->state = SIM_STATE_TRANSMIT;
+}
+
+static void onewire_sim_rom_command(onewire_sim_device_t *dev, uint8_t cmd)
+{
+    dev->bit_index = 0;
+    dev->search_phase = 0;
+    switch (cmd) {
+    case ONEWIRE_CMD_SEARCH_NORMAL:
+        dev->state = SIM_STATE_SEARCH;
+        break;
+    case ONEWIRE_CMD_SEARCH_ALARM:
+        onewire_sim_update_conversion(dev);
+        dev->state = dev->alarm ? SIM_STATE_SEARCH : SIM_STATE_IDLE;
+        break;
+    case ONEWIRE_CMD_MATCH_ROM:
+        dev->state = SIM_STATE_MATCH_ROM;
+        break;
+    case ONEWIRE_CMD_SKIP_ROM:
+        dev->state = SIM_STATE_FUNC_CMD;
+        break;
+    case ONEWIRE_SIM_CMD_READ_ROM: {
+        uint8_t rom[8];
+        for (int i = 0; i < 8; i++) {
+            rom[i] = (dev->config.address >> (i * 8)) & 0xFF;
+        }
+        onewire_sim_start_transmit(dev, rom, sizeof(rom));
+        break;
+    }
+    default:
+        dev->state = SIM_STATE_IDLE;
+        break;
+    }
+}
+
+static void onewire_sim_function_command(onewire_bus_sim_obj_t *bus_sim, onewire_sim_device_t *dev, uint8_t cmd)
+{
+    dev->bit_index = 0;
+    switch (cmd) {
+    case DS18B20_SIM_CMD_CONVERT_TEMP: {
+        onewire_sim_update_conversion(dev);
+        uint32_t conversion_time_us = dev->config.conversion_time_us ? dev->config.conversion_time_us : ONEWIRE_SIM_DEFAULT_CONVERSION_TIME_US;
+        int resolution = (dev->scratchpad[4] >> 5) & 0x03;
+        dev->converting = true;
+        dev->conversion_end_us = esp_timer_get_time() + (conversion_time_us >> (3 - resolution));
+        dev->state = SIM_STATE_CONVERTING;
+        break;
+    }
+    case DS18B20_SIM_CMD_WRITE_SCRATCHPAD:
+        dev->state = SIM_STATE_WRITE_SCRATCHPAD;
+        break;
+    case DS18B20_SIM_CMD_READ_SCRATCHPAD: {
+        uint8_t data[DS18B20_SIM_SCRATCHPAD_SIZE];
+        onewire_sim_update_conversion(dev);
+        memcpy(data, dev->scratchpad, sizeof(data));
+        if (onewire_sim_chance(bus_sim, dev->config.crc_error_permille)) {
+            uint32_t bit = onewire_sim_random(bus_sim) % (sizeof(data) * 8);
+            data[bit / 8] ^= 1 << (bit % 8);
+            bus_sim->stats.crc_errors_injected++;
+        }
+        onewire_sim_start_transmit(dev, data, sizeof(data));
+        break;
+    }
+    case DS18B20_SIM_CMD_COPY_SCRATCHPAD:
+        memcpy(dev->eeprom, &dev->scratchpad[2], sizeof(dev->eeprom));
+        dev->state = SIM_STATE_IDLE;
+        break;
+    case DS18B20_SIM_CMD_RECALL_EEPROM:
+        memcpy(&dev->scratchpad[2], dev->eeprom, sizeof(dev->eeprom));
+        onewire_sim_update_crc(dev);
+        dev->state = SIM_STATE_IDLE; // recall is instant, read slots see a released bus
+        break;
+    default:
+        // including Read Power Supply, a device with external power just leaves the bus released
+        dev->state = SIM_STATE_IDLE;
+        break;
+    }
+}
+
+// bits are received LSB first, returns true when a whole byte is in rx_byte
+static bool onewire_sim_receive_bit(onewire_sim_device_t *dev, uint8_t bit)
+{
+    dev->rx_byte = (dev->rx_byte >> 1) | (bit ? 0x80 : 0x00);
+    return (++dev->bit_index % 8) == 0;
+}
+
+static void onewire_sim_device_write_slot(onewire_bus_sim_obj_t *bus_sim, onewire_sim_device_t *dev, uint8_t bit)
+{
+    switch (dev->state) {
+    case SIM_STATE_ROM_CMD:
+        if (onewire_sim_receive_bit(dev, bit)) {
+            onewire_sim_rom_command(dev, dev->rx_byte);
+        }
+        break;
+    case SIM_STATE_SEARCH:
+        if (dev->search_phase != 2) {
+            break; // the master is not supposed to write here
+        }
+        if (bit != onewire_sim_rom_bit(dev, dev->bit_index)) {
+            dev->state = SIM_STATE_IDLE; // deselected until the next reset
+            break;
+        }
+        dev->search_phase = 0;
+        if (++dev->bit_index == 64) {
+            dev->bit_index = 0;
+            dev->state = SIM_STATE_FUNC_CMD;
+        }
+        break;
+    case SIM_STATE_MATCH_ROM:
+        if (bit != onewire_sim_rom_bit(dev, dev->bit_index)) {
+            dev->state = SIM_STATE_IDLE;
+            break;
+        }
+        if (++dev->bit_index == 64) {
+            dev->bit_index = 0;
+            dev->state = SIM_STATE_FUNC_CMD;
+        }
+        break;
+    case SIM_STATE_FUNC_CMD:
+        if (onewire_sim_receive_bit(dev, bit)) {
+            onewire_sim_function_command(bus_sim, dev, dev->rx_byte);
+        }
+        break;
+    case SIM_STATE_WRITE_SCRATCHPAD:
+        if (onewire_sim_receive_bit(dev, bit)) {
+            int index = dev->bit_index / 8 - 1;
+            if (index == 2) {
+                // only the resolution bits of the configuration register are writable
+                dev->scratchpad[4] = (dev->rx_byte & 0x60) | 0x1F;
+                dev->state = SIM_STATE_IDLE;
+            } else {
+                dev->scratchpad[2 + index] = dev->rx_byte;
+            }
+            onewire_sim_update_crc(dev);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static uint8_t onewire_sim_device_read_slot(onewire_sim_device_t *dev)
+{
+    switch (dev->state) {
+    case SIM_STATE_SEARCH:
+        if (dev->search_phase == 0) {
+            dev->search_phase = 1;
+            return onewire_sim_rom_bit(dev, dev->bit_index);
+        }
+        if (dev->search_phase == 1) {
+            dev->search_phase = 2;
+            return onewire_sim_rom_bit(dev, dev->bit_index) ^ 0x01;
+        }
+        return 1;
+    case SIM_STATE_TRANSMIT:
+        if (dev->bit_index < dev->tx_bits) {
+            uint8_t bit = (dev->tx_buf[dev->bit_index / 8] >> (dev->bit_index % 8)) & 0x01;
+            dev->bit_index++;
+            return bit;
+        }
+        return 1;
+    case SIM_STATE_CONVERTING:
+        // the device holds the bus low while converting
+        onewire_sim_update_conversion(dev);
+        return dev->converting ? 0 : 1;
+    default:
+        return 1;
+    }
+}
+
+static esp_err_t onewire_sim_reset(onewire_bus_sim_obj_t *bus_sim)
+{
+    bool presence = false;
+    bus_sim->stats.resets++;
+    bus_sim->stats.bus_time_us += ONEWIRE_SIM_RESET_DURATION;
+    for (size_t i = 0; i < bus_sim->num_devices; i++) {
+        onewire_sim_device_t *dev = &bus_sim->devices[i];
+        dev->state = SIM_STATE_IDLE;
+        if (!dev->connected) {
+            continue;
+        }
+        if (onewire_sim_chance(bus_sim, dev->config.dropout_permille)) {
+            bus_sim->stats.dropouts_injected++;
+            continue;
+        }
+        dev->state = SIM_STATE_ROM_CMD;
+        dev->bit_index = 0;
+        presence = true;
+    }
+    return presence ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+static void onewire_sim_write_bit(onewire_bus_sim_obj_t *bus_sim, uint8_t tx_bit)
+{
+    bus_sim->stats.write_slots++;
+    bus_sim->stats.bus_time_us += ONEWIRE_SIM_SLOT_DURATION;
+    for (size_t i = 0; i < bus_sim->num_devices; i++) {
+        onewire_sim_device_write_slot(bus_sim, &bus_sim->devices[i], tx_bit ? 1 : 0);
+    }
+}
+
+// the bus is a wired-AND: it reads 0 as soon as one device pulls it down
+static uint8_t onewire_sim_read_bit(onewire_bus_sim_obj_t *bus_sim)
+{
+    uint8_t level = 1;
+    bus_sim->stats.read_slots++;
+    bus_sim->stats.bus_time_us += ONEWIRE_SIM_SLOT_DURATION;
+    for (size_t i = 0; i < bus_sim->num_devices; i++) {
+        level &= onewire_sim_device_read_slot(&bus_sim->devices[i]);
+    }
+    return level;
+}
+
+static void onewire_sim_write_bytes(onewire_bus_sim_obj_t *bus_sim, const uint8_t *tx_data, size_t tx_data_size)
+{
+    for (size_t i = 0; i < tx_data_size; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            onewire_sim_write_bit(bus_sim, (tx_data[i] >> bit) & 0x01);
+        }
+    }
+}
+
+static void onewire_sim_read_bytes(onewire_bus_sim_obj_t *bus_sim, uint8_t *rx_buf, size_t rx_buf_size)
+{
+    for (size_t i = 0; i < rx_buf_size; i++) {
+        rx_buf[i] = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            rx_buf[i] |= onewire_sim_read_bit(bus_sim) << bit;
+        }
+    }
+}
+
+static esp_err_t onewire_bus_sim_reset(onewire_bus_handle_t bus)
+{
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    esp_err_t ret = onewire_sim_reset(bus_sim);
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ret;
+}
+
+static esp_err_t onewire_bus_sim_write_bytes(onewire_bus_handle_t bus, const uint8_t *tx_data, uint8_t tx_data_size)
+{
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    onewire_sim_write_bytes(bus_sim, tx_data, tx_data_size);
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t onewire_bus_sim_read_bytes(onewire_bus_handle_t bus, uint8_t *rx_buf, size_t rx_buf_size)
+{
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    onewire_sim_read_bytes(bus_sim, rx_buf, rx_buf_size);
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t onewire_bus_sim_write_bit(onewire_bus_handle_t bus, uint8_t tx_bit)
+{
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    onewire_sim_write_bit(bus_sim, tx_bit);
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t onewire_bus_sim_read_bit(onewire_bus_handle_t bus, uint8_t *rx_bit)
+{
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    *rx_bit = onewire_sim_read_bit(bus_sim);
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t onewire_bus_sim_triplet(onewire_bus_handle_t bus, uint8_t preferred_direction, uint8_t *id_bit, uint8_t *cmp_id_bit, uint8_t *taken_direction)
+{
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    *id_bit = onewire_sim_read_bit(bus_sim);
+    *cmp_id_bit = onewire_sim_read_bit(bus_sim);
+    *taken_direction = onewire_bus_triplet_direction(*id_bit, *cmp_id_bit, preferred_direction);
+    onewire_sim_write_bit(bus_sim, *taken_direction);
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t onewire_bus_sim_transaction(onewire_bus_handle_t bus, const onewire_bus_transaction_t *trans)
+{
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    if (!trans->flags.no_reset) {
+        ret = onewire_sim_reset(bus_sim);
+    }
+    if (ret == ESP_OK) {
+        onewire_sim_write_bytes(bus_sim, trans->tx_data, trans->tx_data_size);
+        onewire_sim_read_bytes(bus_sim, trans->rx_buf, trans->rx_buf_size);
+    }
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ret;
+}
+
+esp_err_t onewire_new_bus_sim(const onewire_bus_sim_config_t *sim_config, onewire_bus_handle_t *ret_bus)
+{
+    esp_err_t ret = ESP_OK;
+    onewire_bus_sim_obj_t *bus_sim = NULL;
+    ESP_RETURN_ON_FALSE(sim_config && ret_bus && (sim_config->devices || !sim_config->num_devices),
+                        ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    bus_sim = calloc(1, sizeof(onewire_bus_sim_obj_t));
+    ESP_RETURN_ON_FALSE(bus_sim, ESP_ERR_NO_MEM, TAG, "no mem for onewire_bus_sim_obj_t");
+
+    if (sim_config->num_devices) {
+        bus_sim->devices = calloc(sim_config->num_devices, sizeof(onewire_sim_device_t));
+        ESP_GOTO_ON_FALSE(bus_sim->devices, ESP_ERR_NO_MEM, err, TAG, "no mem for simulated devices");
+    }
+    bus_sim->num_devices = sim_config->num_devices;
+    bus_sim->rng_state = sim_config->seed ? sim_config->seed : 1;
+
+    for (size_t i = 0; i < bus_sim->num_devices; i++) {
+        onewire_sim_device_t *dev = &bus_sim->devices[i];
+        dev->config = sim_config->devices[i];
+        if ((dev->config.address >> 56) == 0) {
+            uint8_t rom[7];
+            for (int j = 0; j < 7; j++) {
+                rom[j] = (dev->config.address >> (j * 8)) & 0xFF;
+            }
+            dev->config.address |= (onewire_device_address_t)onewire_crc8(0, rom, sizeof(rom)) << 56;
+        }
+        dev->connected = true;
+        // power-on state of the scratchpad
+        dev->eeprom[0] = dev->config.th_user1;
+        dev->eeprom[1] = dev->config.tl_user2;
+        dev->eeprom[2] = dev->config.config ? ((dev->config.config & 0x60) | 0x1F) : 0x7F;
+        const uint8_t power_on[DS18B20_SIM_SCRATCHPAD_SIZE] = {0x50, 0x05, 0, 0, 0, 0xFF, 0x0C, 0x10, 0}; // 85 C
+        memcpy(dev->scratchpad, power_on, sizeof(power_on));
+        memcpy(&dev->scratchpad[2], dev->eeprom, sizeof(dev->eeprom));
+        onewire_sim_update_crc(dev);
+    }
+
+    bus_sim->bus_mutex = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(bus_sim->bus_mutex, ESP_ERR_NO_MEM, err, TAG, "bus mutex creation failed");
+
+    bus_sim->base.del = onewire_bus_sim_del;
+    bus_sim->base.reset = onewire_bus_sim_reset;
+    bus_sim->base.write_bit = onewire_bus_sim_write_bit;
+    bus_sim->base.write_bytes = onewire_bus_sim_write_bytes;
+    bus_sim->base.read_bit = onewire_bus_sim_read_bit;
+    bus_sim->base.read_bytes = onewire_bus_sim_read_bytes;
+    bus_sim->base.triplet = onewire_bus_sim_triplet;
+    bus_sim->base.transaction = onewire_bus_sim_transaction;
+    *ret_bus = &bus_sim->base;
+
+    return ret;
+
+err:
+    free(bus_sim->devices);
+    free(bus_sim);
+    return ret;
+}
+
+static esp_err_t onewire_bus_sim_del(onewire_bus_handle_t bus)
+{
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+    vSemaphoreDelete(bus_sim->bus_mutex);
+    free(bus_sim->devices);
+    free(bus_sim);
+    return ESP_OK;
+}
+
+static onewire_sim_device_t *onewire_bus_sim_get_device(onewire_bus_handle_t bus, size_t index)
+{
+    if (!bus || bus->del != onewire_bus_sim_del) {
+        return NULL;
+    }
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+    return index < bus_sim->num_devices ? &bus_sim->devices[index] : NULL;
+}
+
+esp_err_t onewire_bus_sim_set_temperature(onewire_bus_handle_t bus, size_t index, float temperature)
+{
+    onewire_sim_device_t *dev = onewire_bus_sim_get_device(bus, index);
+    ESP_RETURN_ON_FALSE(dev, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    dev->config.temperature = temperature;
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ESP_OK;
+}
+
+esp_err_t onewire_bus_sim_set_connected(onewire_bus_handle_t bus, size_t index, bool connected)
+{
+    onewire_sim_device_t *dev = onewire_bus_sim_get_device(bus, index);
+    ESP_RETURN_ON_FALSE(dev, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    dev->connected = connected;
+    if (!connected) {
+        dev->state = SIM_STATE_IDLE;
+    }
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ESP_OK;
+}
+
+esp_err_t onewire_bus_sim_get_stats(onewire_bus_handle_t bus, onewire_bus_sim_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(bus && stats && bus->del == onewire_bus_sim_del, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    onewire_bus_sim_obj_t *bus_sim = __containerof(bus, onewire_bus_sim_obj_t, base);
+
+    xSemaphoreTake(bus_sim->bus_mutex, portMAX_DELAY);
+    *stats = bus_sim->stats;
+    xSemaphoreGive(bus_sim->bus_mutex);
+    return ESP_OK;
+}
@@ -18,6 +18,9 @@ typedef struct onewire_device_iter_t {
     onewire_bus_handle_t bus;
     uint16_t last_discrepancy;
     bool is_last_device;
+    bool family_search;
+    bool alarm_search;
+    uint8_t family_code;
     uint8_t rom_number[sizeof(onewire_device_address_t)];
 } onewire_device_iter_t;
 
@@ -43,6 +46,31 @@ esp_err_t onewire_del_device_iter(onewire_device_iter_handle_t iter)
     return ESP_OK;
 }
 
+esp_err_t onewire_device_iter_set_family(onewire_device_iter_handle_t iter, uint8_t family_code)
+{
+    ESP_RETURN_ON_FALSE(iter, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    // preset the ROM number with the family code and follow it on every discrepancy during the first search,
+    // this leads to the first device of the family, if there is any
+    memset(iter->rom_number, 0, sizeof(iter->rom_number));
+    iter->rom_number[0] = family_code;
+    iter->last_discrepancy = sizeof(onewire_device_address_t) * 8;
+    iter->is_last_device = false;
+    iter->family_search = true;
+    iter->family_code = family_code;
+
+    return ESP_OK;
+}
+
+esp_err_t onewire_device_iter_set_alarm_search(onewire_device_iter_handle_t iter, bool en_alarm_search)
+{
+    ESP_RETURN_ON_FALSE(iter, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    iter->alarm_search = en_alarm_search;
+
+    return ESP_OK;
+}
+
 // Search algorithm inspired by https://www.analog.com/en/app-notes/1wire-search-algorithm.html
 esp_err_t onewire_device_iter_get_next(onewire_device_iter_handle_t iter, onewire_device_t *dev)
 {
@@ -52,6 +80,12 @@ esp_err_t onewire_device_iter_get_next(onewire_device_iter_handle_t iter, onewir
         ESP_LOGD(TAG, "1-wire rom search finished");
         return ESP_ERR_NOT_FOUND;
     }
+    // the next search would turn at a bit of the family code, so there is no more device of that family
+    if (iter->family_search && iter->last_discrepancy < 8) {
+        ESP_LOGD(TAG, "1-wire rom search left family %02X", iter->family_code);
+        iter->is_last_device = true;
+        return ESP_ERR_NOT_FOUND;
+    }
     onewire_bus_handle_t bus = iter->bus;
     esp_err_t reset_result = onewire_bus_reset(bus);
     if (reset_result == ESP_ERR_NOT_FOUND) {
@@ -62,38 +96,44 @@ esp_err_t onewire_device_iter_get_next(onewire_device_iter_handle_t iter, onewir
 
     // send rom search command and start search algorithm
     ESP_RETURN_ON_ERROR(onewire_bus_write_bytes(bus, (uint8_t[]) {
-        ONEWIRE_CMD_SEARCH_NORMAL
-    }, 1), TAG, "send ONEWIRE_CMD_SEARCH_NORMAL failed");
+        iter->alarm_search ? ONEWIRE_CMD_SEARCH_ALARM : ONEWIRE_CMD_SEARCH_NORMAL
+    }, 1), TAG, "send rom search command failed");
 
     uint8_t last_zero = 0;
     for (uint16_t rom_bit_index = 0; rom_bit_index < sizeof(onewire_device_address_t) * 8; rom_bit_index ++) {
         uint8_t rom_byte_index = rom_bit_index / 8;
         uint8_t rom_bit_mask = 1 << (rom_bit_index % 8); // calculate byte index and bit mask in advance for convenience
 
+        // direction to take if there is a discrepancy at this bit
+        uint8_t preferred_direction;
+        if (rom_bit_index < iter->last_discrepancy) { // current id bit is before the last discrepancy bit
+            preferred_direction = (iter->rom_number[rom_byte_index] & rom_bit_mask) ? 0x01 : 0x00; // follow previous way
+        } else {
+            preferred_direction = (rom_bit_index == iter->last_discrepancy) ? 0x01 : 0x00; // search for 0 bit first
+        }
+
+        // read a bit and its complement, then write the search direction, in one bus call
         uint8_t rom_bit = 0;
         uint8_t rom_bit_complement = 0;
-        ESP_RETURN_ON_ERROR(onewire_bus_read_bit(bus, &rom_bit), TAG, "read rom_bit error"); // write 1 bit to read from the bus
-        ESP_RETURN_ON_ERROR(onewire_bus_read_bit(bus, &rom_bit_complement), TAG, "read rom_bit_complement error"); // read a bit and its complement
+        uint8_t search_direction = 0;
+        ESP_RETURN_ON_ERROR(onewire_bus_triplet(bus, preferred_direction, &rom_bit, &rom_bit_complement, &search_direction),
+                            TAG, "rom search triplet error");
 
         // No devices participating in search.
         if (rom_bit && rom_bit_complement) {
-            ESP_LOGE(TAG, "no devices participating in search");
-            return ESP_ERR_NOT_FOUND;
-        }
-
-        uint8_t search_direction;
-        if (rom_bit != rom_bit_complement) { // There are only 0s or 1s in the bit of the participating ROM numbers.
-            search_direction = rom_bit;  // just go ahead
-        } else { // There are both 0s and 1s in the current bit position of the participating ROM numbers. This is a discrepancy.
-            if (rom_bit_index < iter->last_discrepancy) { // current id bit is before the last discrepancy bit
-                search_direction = (iter->rom_number[rom_byte_index] & rom_bit_mask) ? 0x01 : 0x00; // follow previous way
+            if (iter->alarm_search) {
+                // quite normal, no device is in alarm state
+                ESP_LOGD(TAG, "no devices participating in alarm search");
+                iter->is_last_device = true;
             } else {
-                search_direction = (rom_bit_index == iter->last_discrepancy) ? 0x01 : 0x00; // search for 0 bit first
+                ESP_LOGE(TAG, "no devices participating in search");
             }
+            return ESP_ERR_NOT_FOUND;
+        }
 
-            if (search_direction == 0) { // record zero's position in last zero
-                last_zero = rom_bit_index;
-            }
+        // There are both 0s and 1s in the current bit position of the participating ROM numbers. This is a discrepancy.
+        if (rom_bit == rom_bit_complement && search_direction == 0) { // record zero's position in last zero
+            last_zero = rom_bit_index;
         }
 
         if (search_direction == 1) { // set corrsponding rom bit by search direction
@@ -101,9 +141,6 @@ esp_err_t onewire_device_iter_get_next(onewire_device_iter_handle_t iter, onewir
         } else {
             iter->rom_number[rom_byte_index] &= ~rom_bit_mask;
         }
-
-        // set search direction
-        ESP_RETURN_ON_ERROR(onewire_bus_write_bit(bus, search_direction), TAG, "write direction bit error");
     }
 
     // if the search was successful
@@ -112,6 +149,13 @@ esp_err_t onewire_device_iter_get_next(onewire_device_iter_handle_t iter, onewir
         iter->is_last_device = true;
     }
 
+    // no device of the target family at all, the search ended up in another one
+    if (iter->family_search && iter->rom_number[0] != iter->family_code) {
+        ESP_LOGD(TAG, "no 1-wire device of family %02X", iter->family_code);
+        iter->is_last_device = true;
+        return ESP_ERR_NOT_FOUND;
+    }
+
     // check crc
     ESP_RETURN_ON_FALSE(onewire_crc8(0, iter->rom_number, 7) == iter->rom_number[7], ESP_ERR_INVALID_CRC, TAG, "bad device crc");
 
@@ -3,6 +3,7 @@
  *
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  */
+#include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "onewire_bus.h"
@@ -17,6 +18,20 @@ void app_main(void)
 {
     // install new 1-wire bus
     onewire_bus_handle_t bus;
+#if CONFIG_IDF_TARGET_LINUX
+    // no 1-Wire hardware on the host, two virtual DS18B20 and another device instead
+    const onewire_bus_sim_device_config_t sim_devices[] = {
+        { .address = 0x0000000000A1B228, .temperature = 21.5f },
+        { .address = 0x0000000000C3D428, .temperature = 23.0f },
+        { .address = 0x0000000000E5F601 },
+    };
+    onewire_bus_sim_config_t sim_config = {
+        .devices = sim_devices,
+        .num_devices = sizeof(sim_devices) / sizeof(sim_devices[0]),
+    };
+    ESP_ERROR_CHECK(onewire_new_bus_sim(&sim_config, &bus));
+    ESP_LOGI(TAG, "1-Wire bus installed on GPIO%d (simulated)", EXAMPLE_ONEWIRE_BUS_GPIO);
+#else
     onewire_bus_config_t bus_config = {
         .bus_gpio_num = EXAMPLE_ONEWIRE_BUS_GPIO,
         .flags = {
@@ -28,6 +43,7 @@ void app_main(void)
     };
     ESP_ERROR_CHECK(onewire_new_bus_rmt(&bus_config, &rmt_config, &bus));
     ESP_LOGI(TAG, "1-Wire bus installed on GPIO%d", EXAMPLE_ONEWIRE_BUS_GPIO);
+#endif
 
     int onewire_device_found = 0;
     onewire_device_iter_handle_t iter = NULL;
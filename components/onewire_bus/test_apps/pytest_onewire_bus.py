@@ -8,3 +8,11 @@ def test_onewire_bus(dut: Dut) -> None:
     dut.expect_exact('test-app: 1-Wire bus installed on GPIO')
     dut.expect_exact('test-app: Device iterator created, start searching')
     dut.expect_exact('test-app: Searching done')
+
+
+@pytest.mark.linux
+@pytest.mark.host_test
+def test_onewire_bus_sim(dut: Dut) -> None:
+    dut.expect_exact('test-app: 1-Wire bus installed on GPIO')
+    dut.expect_exact('test-app: Found a new device')
+    dut.expect_exact('test-app: Searching done, 2 device(s) found')
@@ -1,27 +1,104 @@
+// Sequence number of the last sample shown, the long-poll asks for anything newer
+let lastSeq = 0;
+// Settings generation the inputs were filled from, a save is refused if someone else saved since
+let lastGen = null;
+
+function render(data) {
+    lastSeq = data.seq;
+    if (document.getElementById('t0').value === '') lastGen = data.gen;
+    const currTempDiv = document.getElementById('currTemp');
+    currTempDiv.innerText = data.temp.toFixed(1) + ' °C';
+    let color = '#03dac6';
+    for (let i = 4; i >= 0; i--) {
+        if (data.temp >= data.limits[i]) {
+            const led = document.getElementById('t'+i).previousElementSibling.querySelector('.led-indicator');
+            color = led.style.background;
+            break;
+        }
+    }
+    currTempDiv.style.color = color;
+    if(document.getElementById('t0').value === '') {
+        for(let i=0; i<5; i++)
+            document.getElementById('t'+i).value = data.limits[i].toFixed(1);
+        const periodInput = document.getElementById('period');
+        if (periodInput && data.period_ms) periodInput.value = data.period_ms;
+    }
+}
+
+// Little-endian record of /api/data.bin: u8 version, u8 kind, u16 record size,
+// u32 seq, u64 t_ms, f32 temp, f32 limits[5], u32 gen, u32 period_ms
+// (fields are only appended, the record size tells)
+function decodeData(buf) {
+    const view = new DataView(buf);
+    if (view.getUint8(0) !== 2 || view.getUint8(1) !== 1) throw new Error('Unknown data format');
+    const limits = [];
+    for (let i = 0; i < 5; i++) limits.push(view.getFloat32(20 + 4 * i, true));
+    const size = view.getUint16(2, true);
+    const gen = size >= 40 ? view.getUint32(40, true) : null;
+    const period = size >= 44 ? view.getUint32(44, true) : null;
+    return {seq: view.getUint32(4, true), temp: view.getFloat32(16, true), limits: limits, gen: gen, period_ms: period};
+}
+
+function fetchData(url) {
+    return fetch(url).then(res => {
+        if (res.status !== 200) return res;
+        return res.arrayBuffer().then(buf => render(decodeData(buf))).then(() => res);
+    });
+}
+
 function updateData() {
-    fetch('/api/data')
-        .then(res => res.json())
-        .then(data => {
-            const currTempDiv = document.getElementById('currTemp');
-            currTempDiv.innerText = data.temp.toFixed(1) + ' °C';
-            let color = '#03dac6';
-            for (let i = 4; i >= 0; i--) {
-                if (data.temp >= data.limits[i]) {
-                    const led = document.getElementById('t'+i).previousElementSibling.querySelector('.led-indicator');
-                    color = led.style.background;
-                    break;
-                }
-            }
-            currTempDiv.style.color = color;
-            if(document.getElementById('t0').value === '') {
-                for(let i=0; i<5; i++)
-                    document.getElementById('t'+i).value = data.limits[i].toFixed(1);
-            }
-        })
+    fetchData('/api/data.bin')
         .catch(err => console.error(err));
 }
 
+// The device pushes every new sample over /ws, long-polling is only the fallback while it is down
+let polling = false;
+let pollChain = 0; // a restarted fallback must not leave an older request loop running
 
+function longPoll(chain) {
+    if (!polling || chain !== pollChain) return;
+    fetchData('/api/data.bin?after=' + lastSeq)
+        .then(res => {
+            // 204: nothing new before the device's timeout, just ask again
+            if (res.status !== 200 && res.status !== 204) throw new Error('HTTP ' + res.status);
+        })
+        .then(() => longPoll(chain))
+        .catch(err => {
+            console.error(err);
+            setTimeout(() => longPoll(chain), 2000);
+        });
+}
+
+function startPolling() {
+    if (!polling) {
+        polling = true;
+        longPoll(++pollChain);
+    }
+}
+
+function stopPolling() {
+    polling = false;
+}
+
+function connectSocket() {
+    if (!('WebSocket' in window)) {
+        startPolling();
+        return;
+    }
+    const ws = new WebSocket((location.protocol === 'https:' ? 'wss://' : 'ws://') + location.host + '/ws');
+    ws.onopen = stopPolling;
+    ws.onmessage = ev => {
+        try {
+            render(JSON.parse(ev.data));
+        } catch (err) {
+            console.error(err);
+        }
+    };
+    ws.onclose = () => {
+        startPolling();
+        setTimeout(connectSocket, 5000);
+    };
+}
 
 
 function sendData() {
@@ -30,18 +107,27 @@ function sendData() {
     for(let i=0; i<5; i++) {
         payload.limits.push(parseFloat(document.getElementById('t'+i).value));
     }
+    const periodInput = document.getElementById('period');
+    const period = periodInput ? parseInt(periodInput.value, 10) : NaN;
+    if (!isNaN(period)) payload.period_ms = period;
     
+    const headers = { 'Content-Type': 'application/json' };
+    if (lastGen !== null) headers['If-Match'] = '"' + lastGen + '"';
     fetch('/api/settings', {
         method: 'POST',
-        headers: {
-            'Content-Type': 'application/json'
-        },
+        headers: headers,
         body: JSON.stringify(payload)
     })
     .then(res => { 
         if(res.ok) {
+            lastGen = parseInt((res.headers.get('ETag') || '').replace(/"/g, ''), 10);
             alert('Настройки сохранены!'); 
             updateData(); 
+        } else if (res.status === 409) {
+            // someone saved in between: show their values instead of overwriting them
+            alert('Настройки были изменены с другого устройства, значения обновлены');
+            document.getElementById('t0').value = '';
+            updateData();
         } else {
             alert('Ошибка сервера! Код: ' + res.status); 
         }
@@ -53,6 +139,6 @@ function sendData() {
 }
 
 document.addEventListener('DOMContentLoaded', () => {
-    setInterval(updateData, 1200); 
     updateData();
+    connectSocket();
 });
\ No newline at end of file
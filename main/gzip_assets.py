@@ -17,6 +17,7 @@ def main():
     out_html = data_dir / "page.html"
     css_file = data_dir / "style.css"
     js_file = data_dir / "script.js"
+    etag_header = root / "include" / "asset_etags.h"
 
     # hashes
     css_hash = hashlib.sha1(css_file.read_bytes()).hexdigest()[:8]
@@ -29,6 +30,19 @@ def main():
     out_html.write_text(html, encoding="utf-8")
     print(f"GZIP assets: page.html (style={css_hash}, script={js_hash})")
 
+    # strong ETags for the web server, from the same hashes
+    html_hash = hashlib.sha1(out_html.read_bytes()).hexdigest()[:8]
+    header = (
+        "/* Generated by gzip_assets.py, do not edit */\n"
+        "#pragma once\n\n"
+        f"#define ASSET_ETAG_PAGE   \"\\\"{html_hash}\\\"\"\n"
+        f"#define ASSET_ETAG_STYLE  \"\\\"{css_hash}\\\"\"\n"
+        f"#define ASSET_ETAG_SCRIPT \"\\\"{js_hash}\\\"\"\n"
+    )
+    # only touch the header when a hash changed, so C sources are not rebuilt for nothing
+    if not etag_header.exists() or etag_header.read_text(encoding="utf-8") != header:
+        etag_header.write_text(header, encoding="utf-8")
+
     # gzip all three: page.html, style.css, script.js
     gzip_file(out_html, data_dir / "page.html.gz")
     gzip_file(css_file, data_dir / "style.css.gz")
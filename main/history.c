@@ -0,0 +1,176 @@
+#include "history.h"
+
+#include <math.h>
+
+#include "tslog.h"
+#include "rollup.h"
+#include "sample_bus.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "HISTORY";
+
+/*
+ * Packed ring: temperature in 1/16 C (the DS18B20's own LSB) and the time since the previous record in 10 ms units.
+ * Only the time of the oldest and the newest record is kept in full, the others are rebuilt by adding up deltas.
+ * A pause longer than a delta can hold is bridged with gap records that carry no temperature.
+ */
+#define HISTORY_DT_UNIT_MS 10
+#define HISTORY_DT_MAX UINT16_MAX
+#define HISTORY_GAP INT16_MIN
+
+typedef struct {
+    int16_t temp_x16;
+    uint16_t dt;
+} history_record_t;
+
+static history_record_t s_ring[HISTORY_CAPACITY];
+static uint32_t s_total = 0;        // records ever written, the newest has index s_total - 1
+static uint64_t s_oldest_ms = 0;    // time of the oldest record still in the ring
+static uint64_t s_newest_ms = 0;
+static SemaphoreHandle_t s_mutex = NULL;
+
+static inline uint32_t oldest_index(void)
+{
+    return s_total > HISTORY_CAPACITY ? s_total - HISTORY_CAPACITY : 0;
+}
+
+static void push_record(int16_t temp_x16, uint16_t dt)
+{
+    if (s_total >= HISTORY_CAPACITY) {
+        // the oldest record goes, the next one becomes the oldest
+        s_oldest_ms += s_ring[(s_total - HISTORY_CAPACITY + 1) % HISTORY_CAPACITY].dt * HISTORY_DT_UNIT_MS;
+    }
+    s_ring[s_total % HISTORY_CAPACITY] = (history_record_t) {
+        .temp_x16 = temp_x16,
+        .dt = dt,
+    };
+    s_total++;
+}
+
+/* Sample bus consumer for everything kept in RAM: the ring and the rollups */
+static void history_task(void *arg)
+{
+    sample_bus_sub_t *sub = sample_bus_subscribe("history");
+    sample_t sample;
+    while (sub != NULL) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (sample_bus_take(sub, &sample)) {
+            history_add(sample.t_ms, sample.temperature);
+            rollup_add(sample.t_ms, sample.temperature);
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+void history_init(void)
+{
+    if (s_mutex != NULL) {
+        return;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    configASSERT(s_mutex);
+    if (xTaskCreate(history_task, "history", 2560, NULL, 3, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create history task");
+    }
+}
+
+uint64_t history_now_ms(void)
+{
+    return tslog_now_ms();
+}
+
+void history_add(uint64_t now, float temp)
+{
+    float scaled = fminf(fmaxf(temp * 16.0f, HISTORY_GAP + 1), INT16_MAX);
+    int16_t temp_x16 = (int16_t)lroundf(scaled);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_total == 0) {
+        s_oldest_ms = s_newest_ms = now;
+        push_record(temp_x16, 0);
+    } else {
+        // times advance by whole units, so rounding never accumulates
+        uint64_t dt = (now - s_newest_ms + HISTORY_DT_UNIT_MS / 2) / HISTORY_DT_UNIT_MS;
+        while (dt > HISTORY_DT_MAX) {
+            push_record(HISTORY_GAP, HISTORY_DT_MAX);
+            s_newest_ms += HISTORY_DT_MAX * HISTORY_DT_UNIT_MS;
+            dt -= HISTORY_DT_MAX;
+        }
+        push_record(temp_x16, dt);
+        s_newest_ms += dt * HISTORY_DT_UNIT_MS;
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+/* Time of the record before the oldest one, the oldest record's time minus its delta */
+static inline uint64_t before_oldest_ms(void)
+{
+    return s_oldest_ms - s_ring[oldest_index() % HISTORY_CAPACITY].dt * HISTORY_DT_UNIT_MS;
+}
+
+void history_cursor_init(history_cursor_t *cursor)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    cursor->index = oldest_index();
+    cursor->t_ms = before_oldest_ms();
+    xSemaphoreGive(s_mutex);
+}
+
+uint64_t history_oldest_ms(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint64_t oldest = s_total > 0 ? s_oldest_ms : UINT64_MAX;
+    xSemaphoreGive(s_mutex);
+    return oldest;
+}
+
+size_t history_count(uint64_t from_ms, uint64_t to_ms)
+{
+    size_t count = 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint64_t t = before_oldest_ms();
+    for (uint32_t i = oldest_index(); i < s_total; ++i) {
+        const history_record_t *rec = &s_ring[i % HISTORY_CAPACITY];
+        t += rec->dt * HISTORY_DT_UNIT_MS;
+        if (t > to_ms) {
+            break;
+        }
+        if (t >= from_ms && rec->temp_x16 != HISTORY_GAP) {
+            count++;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    return count;
+}
+
+size_t history_read(history_cursor_t *cursor, uint64_t from_ms, uint64_t to_ms, history_sample_t *out, size_t max)
+{
+    size_t n = 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (cursor->index < oldest_index()) {
+        // the writer lapped this reader, carry on from the oldest record
+        cursor->index = oldest_index();
+        cursor->t_ms = before_oldest_ms();
+    }
+    while (n < max && cursor->index < s_total) {
+        const history_record_t *rec = &s_ring[cursor->index % HISTORY_CAPACITY];
+        uint64_t t = cursor->t_ms + rec->dt * HISTORY_DT_UNIT_MS;
+        if (t > to_ms) {
+            break;
+        }
+        if (t >= from_ms && rec->temp_x16 != HISTORY_GAP) {
+            out[n++] = (history_sample_t) {
+                .t_ms = t,
+                .temp = rec->temp_x16 / 16.0f,
+            };
+        }
+        cursor->index++;
+        cursor->t_ms = t;
+    }
+    xSemaphoreGive(s_mutex);
+    return n;
+}
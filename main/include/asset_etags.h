@@ -0,0 +1,6 @@
+/* Generated by gzip_assets.py, do not edit */
+#pragma once
+
+#define ASSET_ETAG_PAGE   "\"c7a6f361\""
+#define ASSET_ETAG_STYLE  "\"73f7b44d\""
+#define ASSET_ETAG_SCRIPT "\"b54b4488\""
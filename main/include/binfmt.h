@@ -0,0 +1,63 @@
+#ifndef BINFMT_H
+#define BINFMT_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Binary API payloads, all little-endian. Every payload starts with the same 4 byte header:
+ *   u8 version, u8 kind, u16 record size
+ * /api/data.bin:    header, then one record: u32 seq, u64 t_ms, f32 temp, f32 limits[5], u32 settings generation,
+ *                    u32 sample period in ms
+ * /api/history.bin: header, u64 now_ms, then records: u32 age_ms (now_ms - t), i16 temp in 1/16 C
+ *   or, for a range served from a rollup tier (kind 3): header, u64 now_ms, u32 period_ms,
+ *   then records: u32 age_ms of the bucket start, i16 avg, i16 min, i16 max in 1/16 C
+ * Times are history_now_ms(). Version 1 had u32 times in ms since boot.
+ * Within a version fields are only ever appended, decoders go by the record size.
+ */
+#define BINFMT_VERSION 2
+#define BINFMT_KIND_DATA 1
+#define BINFMT_KIND_HISTORY 2
+#define BINFMT_KIND_ROLLUP 3
+#define BINFMT_HEADER_SIZE 4
+#define BINFMT_DATA_RECORD_SIZE 44
+#define BINFMT_HISTORY_RECORD_SIZE 6
+#define BINFMT_ROLLUP_RECORD_SIZE 10
+#define BINFMT_CONTENT_TYPE "application/octet-stream"
+
+static inline uint8_t *binfmt_put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static inline uint8_t *binfmt_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+static inline uint8_t *binfmt_put_u64(uint8_t *p, uint64_t v)
+{
+    return binfmt_put_u32(binfmt_put_u32(p, (uint32_t)v), (uint32_t)(v >> 32));
+}
+
+static inline uint8_t *binfmt_put_f32(uint8_t *p, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return binfmt_put_u32(p, bits);
+}
+
+static inline uint8_t *binfmt_put_header(uint8_t *p, uint8_t kind, uint16_t record_size)
+{
+    p[0] = BINFMT_VERSION;
+    p[1] = kind;
+    return binfmt_put_u16(p + 2, record_size);
+}
+
+#endif // BINFMT_H
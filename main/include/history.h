@@ -0,0 +1,39 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* 4 bytes per sample: 8192 samples is 32 KB, a bit over 2 h at one sample per second */
+#define HISTORY_CAPACITY 8192
+
+typedef struct {
+    uint64_t t_ms;          // history_now_ms() of the sample
+    float temp;
+} history_sample_t;
+
+/* Position of a reader in the ring, survives the ring moving on between reads */
+typedef struct {
+    uint32_t index;         // absolute index of the next record
+    uint64_t t_ms;          // time of the record before it
+} history_cursor_t;
+
+/* Starts recording what the sample bus publishes into the ring and the rollups, so rollup_init() must come first */
+void history_init(void);
+/* The time base of the history, the flash log's clock: see tslog_now_ms() */
+uint64_t history_now_ms(void);
+void history_add(uint64_t now, float temp);
+/* Time of the oldest sample still in the ring, UINT64_MAX while it is empty */
+uint64_t history_oldest_ms(void);
+
+/* Points the cursor at the oldest sample still in the ring */
+void history_cursor_init(history_cursor_t *cursor);
+/* Number of samples with from_ms <= t <= to_ms */
+size_t history_count(uint64_t from_ms, uint64_t to_ms);
+/*
+ * Copies up to max samples with t >= from_ms from the cursor on, stops after to_ms or at the newest sample.
+ * Returns the number copied, 0 once there is nothing left. Samples overwritten meanwhile are skipped.
+ */
+size_t history_read(history_cursor_t *cursor, uint64_t from_ms, uint64_t to_ms, history_sample_t *out, size_t max);
+
+#endif // HISTORY_H
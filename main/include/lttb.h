@@ -0,0 +1,43 @@
+#ifndef LTTB_H
+#define LTTB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "history.h"
+
+/* Largest number of points a chart can ask for, it sizes the per-bucket averages */
+#define LTTB_MAX_POINTS 1000
+
+/*
+ * Largest-Triangle-Three-Buckets over a range of n samples, in two passes over the same samples in the same order:
+ * lttb_scan() averages the buckets, then lttb_select() and lttb_finish() pick one sample per bucket.
+ * The first and the last sample are always kept. Nothing is allocated, the state is about 16 KB.
+ */
+typedef struct {
+    size_t n;
+    size_t points;
+    double every;           // samples per bucket
+    int pass;
+    size_t index;           // samples seen in the current pass
+    history_sample_t last;  // last sample seen in the current pass
+    history_sample_t end;   // last sample of pass 1, the third point of the last bucket
+    // pass 2: the sample picked last, and the best candidate of the current bucket
+    history_sample_t a;
+    history_sample_t best;
+    double best_area;
+    size_t bucket;
+    double avg_t[LTTB_MAX_POINTS];
+    float avg_temp[LTTB_MAX_POINTS];
+    uint32_t count[LTTB_MAX_POINTS];
+} lttb_t;
+
+/* points is clamped to 3..LTTB_MAX_POINTS, only call this with n > points */
+void lttb_begin(lttb_t *lttb, size_t n, size_t points);
+void lttb_scan(lttb_t *lttb, const history_sample_t *samples, size_t count);
+/* Second pass, out gets the picked samples: at most count + 1 of them */
+size_t lttb_select(lttb_t *lttb, const history_sample_t *samples, size_t count, history_sample_t *out);
+/* Pick of the last bucket and the last sample, at most 2 */
+size_t lttb_finish(lttb_t *lttb, history_sample_t *out);
+
+#endif // LTTB_H
@@ -0,0 +1,41 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Tiers, finest first: 1 min for 12 h, 15 min for 7 days, 1 h for 30 days */
+#define ROLLUP_TIERS 3
+
+typedef struct {
+    uint64_t t_ms;          // start of the bucket
+    float min;
+    float max;
+    float avg;
+} rollup_point_t;
+
+/* Position of a reader in a tier, survives the tier moving on between reads */
+typedef struct {
+    int tier;
+    uint32_t index;         // absolute index of the next bucket
+} rollup_cursor_t;
+
+/* Builds the tiers from the samples in the flash log, so tslog_init() must come first */
+void rollup_init(void);
+/* O(1) per tier: the sample goes into the newest bucket of every tier, or starts a new one */
+void rollup_add(uint64_t t_ms, float temp);
+
+uint32_t rollup_period_ms(int tier);
+/*
+ * Finest tier that covers from_ms and has at most max buckets from there to to_ms,
+ * the coarsest tier if none does
+ */
+int rollup_pick_tier(uint64_t from_ms, uint64_t to_ms, size_t max);
+/* Number of buckets of the tier that start in from_ms..to_ms */
+size_t rollup_count(int tier, uint64_t from_ms, uint64_t to_ms);
+
+void rollup_cursor_init(rollup_cursor_t *cursor, int tier);
+/* Same contract as history_read(), for the buckets that start in from_ms..to_ms */
+size_t rollup_read(rollup_cursor_t *cursor, uint64_t from_ms, uint64_t to_ms, rollup_point_t *out, size_t max);
+
+#endif // ROLLUP_H
@@ -0,0 +1,34 @@
+#ifndef SAMPLE_BUS_H
+#define SAMPLE_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SAMPLE_BUS_MAX_SUBSCRIBERS 6
+/* Samples a subscriber can fall behind before it misses some, a power of two */
+#define SAMPLE_BUS_RING_LEN 32
+
+typedef struct {
+    uint32_t seq;           // sample number since boot, from 1
+    uint64_t t_ms;          // history_now_ms() at acquisition
+    float temperature;
+} sample_t;
+
+typedef struct sample_bus_sub sample_bus_sub_t;
+
+/*
+ * Subscribes the calling task: from now on every published sample is copied into its own ring
+ * and the task gets a task notification. NULL once all SAMPLE_BUS_MAX_SUBSCRIBERS are taken.
+ */
+sample_bus_sub_t *sample_bus_subscribe(const char *name);
+/*
+ * Hands the sample to every subscriber without ever waiting for one: a subscriber whose ring is full
+ * misses the sample, and its overrun counter goes up.
+ */
+void sample_bus_publish(const sample_t *sample);
+/* Oldest sample the subscriber has not taken yet, false if there is none. Only for the subscribed task. */
+bool sample_bus_take(sample_bus_sub_t *sub, sample_t *sample);
+/* Name of the index-th subscriber and the samples it missed so far, false past the last one. Any task may ask. */
+bool sample_bus_overruns(unsigned index, const char **name, uint32_t *overruns);
+
+#endif // SAMPLE_BUS_H
@@ -0,0 +1,18 @@
+#ifndef SENSOR_CACHE_H
+#define SENSOR_CACHE_H
+
+#include <stdint.h>
+
+/* One known DS18B20: ROM code plus the configuration pushed to it */
+typedef struct {
+    uint64_t address;
+    uint8_t resolution;     // ds18b20_resolution_t
+    uint8_t reserved[7];
+} sensor_cache_entry_t;
+
+/* Returns the number of cached sensors copied into entries (0 if nothing is stored) */
+int sensor_cache_load(sensor_cache_entry_t *entries, int max_entries);
+/* Stores the sensor list in NVS, skipped when it matches what is already stored */
+void sensor_cache_save(const sensor_cache_entry_t *entries, int count);
+
+#endif // SENSOR_CACHE_H
@@ -0,0 +1,50 @@
+#ifndef SETTINGS_PARSER_H
+#define SETTINGS_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Largest /api/settings body accepted, anything longer is refused before it is read */
+#define SETTINGS_MAX_BODY 256
+
+/* Fields found in a settings body, only the ones marked present are to be applied */
+typedef struct {
+    float limits[5];
+    bool has_limits;
+    uint32_t period_ms;
+    bool has_period;
+} settings_update_t;
+
+typedef enum {
+    SETTINGS_PARSE_MORE,    // fine so far, feed the next chunk
+    SETTINGS_PARSE_DONE,    // the object is complete, only whitespace may follow
+    SETTINGS_PARSE_ERROR,
+} settings_parse_status_t;
+
+/*
+ * Streaming parser for {"limits":[t0,t1,t2,t3,t4],"period_ms":n}, either key optional, fed chunk by chunk, no allocation.
+ * Unknown keys with scalar or flat array values are skipped, nested objects are refused.
+ */
+typedef struct {
+    int state;
+    int after_value;        // state to go to once the current value is complete
+    char token[24];         // key or number being read
+    size_t token_len;
+    bool in_limits;         // the current key is "limits"
+    bool in_period;         // the current key is "period_ms"
+    int array_index;
+    bool escape;            // the previous character of a key or string was a backslash
+    settings_update_t update;
+} settings_parser_t;
+
+void settings_parser_init(settings_parser_t *parser);
+settings_parse_status_t settings_parser_feed(settings_parser_t *parser, const char *data, size_t len);
+/*
+ * Checks the parsed values: the object must be complete, thresholds finite, in the DS18B20 range and in order,
+ * the period a whole number of milliseconds in THERMOSTAT_PERIOD_MIN_MS..THERMOSTAT_PERIOD_MAX_MS.
+ * Returns NULL if the update is valid, otherwise a short reason for the client.
+ */
+const char *settings_parser_finish(settings_parser_t *parser, settings_update_t *update);
+
+#endif // SETTINGS_PARSER_H
@@ -0,0 +1,12 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+/* Publishes the settings record saved in NVS (if any) and starts the worker that saves changes */
+void settings_store_init(void);
+/*
+ * The published settings changed: the worker saves them once the burst of changes is over.
+ * Never blocks, a burst of calls ends in one NVS commit (none if NVS already holds the same values).
+ */
+void settings_store_mark_dirty(void);
+
+#endif // SETTINGS_STORE_H
@@ -0,0 +1,31 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Largest /api/data payload, {"seq":...,"temp":...,"limits":[...],"gen":...}, the binary one is smaller */
+#define SNAPSHOT_MAX_LEN 144
+
+/* Every sample is rendered in both formats, side by side in the same slot */
+typedef enum {
+    SNAPSHOT_JSON,
+    SNAPSHOT_BINARY,        // see binfmt.h
+} snapshot_format_t;
+
+void snapshot_init(void);
+/*
+ * Renders the /api/data payload from the published thermostat state once and makes it current,
+ * writers are serialized internally. Call it after every thermostat_publish_*().
+ * Every change gets the next sequence number, returns false (and keeps the sequence number) if nothing changed.
+ */
+bool snapshot_publish(void);
+/*
+ * Copies the current payload in the given format into buf without locking,
+ * returns its length (0 if nothing is published yet).
+ * sample_seq, if not NULL, gets the sequence number of the copied payload.
+ */
+size_t snapshot_read(snapshot_format_t format, void *buf, size_t size, uint32_t *sample_seq);
+
+#endif // SNAPSHOT_H
@@ -1,19 +1,53 @@
 #ifndef THERMOSTAT_H
 #define THERMOSTAT_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
 #include "freertos/task.h"
 
+/* Sample period, the finest resolution that still converts in time is used (9-bit takes 100 ms, 12-bit 800 ms) */
+#define THERMOSTAT_PERIOD_MIN_MS 200
+#define THERMOSTAT_PERIOD_MAX_MS 600000
+#define THERMOSTAT_PERIOD_DEFAULT_MS 1000
+
+/* What the sensor task and the web handlers share: the latest sample and the settings */
 typedef struct {
+    uint32_t sample_seq;    // samples published so far
+    float temperature;      // latest sample, 0 until the first one
     float thresholds[5];
-} led_settings_t;
+    uint32_t period_ms;     // one sample every period_ms, on a fixed cadence
+    uint32_t generation;    // bumped by every change of the settings, 0 for the defaults
+} thermostat_state_t;
+
+/* Matches every generation in thermostat_publish_settings() */
+#define THERMOSTAT_ANY_GENERATION UINT32_MAX
+
 
-extern led_settings_t g_settings;
-extern SemaphoreHandle_t settings_mutex;
-extern float current_temperature;
+/*
+ * Consistent copy of the published state, without locking: a copy that raced with a writer is simply taken again.
+ * Writers never wait for readers, they only exclude each other for the few cycles the update takes.
+ */
+void thermostat_state_read(thermostat_state_t *state);
+/* Returns the sequence number of the sample */
+uint32_t thermostat_publish_sample(float temperature);
+/*
+ * Compare-and-swap: replaces the settings only while the generation is still if_generation, returns false if not.
+ * thresholds NULL or period_ms 0 keep the current value. *generation gets the generation current afterwards,
+ * *changed whether this call bumped it. period_ms must be in THERMOSTAT_PERIOD_MIN_MS..THERMOSTAT_PERIOD_MAX_MS.
+ */
+bool thermostat_publish_settings(const float thresholds[5], uint32_t period_ms, uint32_t if_generation,
+                                 uint32_t *generation, bool *changed);
+/* At boot, the settings and the generation they were saved with */
+void thermostat_restore_settings(const float thresholds[5], uint32_t period_ms, uint32_t generation);
 
+/* Starts the sensor task on the board's RMT bus, and the LED task next to it */
 void thermostat_init(void);
+/*
+ * The sensor task. pvParameters is the onewire_bus_handle_t to sample, NULL for the RMT bus on the board,
+ * so it runs unchanged on any other backend, such as onewire_new_bus_sim().
+ */
 void thermostat_task(void *pvParameters);
 
 #endif // THERMOSTAT_H
@@ -0,0 +1,37 @@
+#ifndef TSLOG_H
+#define TSLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "history.h"
+
+/* Data partition the samples are logged to, see partitions.csv */
+#define TSLOG_PARTITION_LABEL "tslog"
+
+/* Position of a reader in the log, survives the writer recycling blocks between reads */
+typedef struct {
+    uint32_t block;         // sequence number of the block
+    uint32_t record;        // index of the next record in it
+    uint64_t t_ms;          // time of the record before it
+} tslog_cursor_t;
+
+/*
+ * Mounts the log partition and starts the writer, which logs every sample published on the sample bus.
+ * Without the partition nothing is logged.
+ */
+void tslog_init(void);
+/*
+ * Milliseconds of logged uptime: continues from the newest sample in the log after a reboot,
+ * so logged times only ever grow, but it stands still while the device is off.
+ */
+uint64_t tslog_now_ms(void);
+
+/* Points the cursor at the block holding from_ms, found by a binary search over the block headers */
+void tslog_cursor_init(tslog_cursor_t *cursor, uint64_t from_ms);
+/* Number of samples with from_ms <= t <= to_ms, only the blocks at both ends are read */
+size_t tslog_count(uint64_t from_ms, uint64_t to_ms);
+/* Same contract as history_read(), blocks that fail their CRC are skipped */
+size_t tslog_read(tslog_cursor_t *cursor, uint64_t from_ms, uint64_t to_ms, history_sample_t *out, size_t max);
+
+#endif // TSLOG_H
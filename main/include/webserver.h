@@ -2,5 +2,7 @@
 #define WEBSERVER_H
 
 void start_webserver(void);
+/* Push the current temperature and thresholds to the /ws clients, safe to call from any task */
+void webserver_notify_update(void);
 
 #endif // WEBSERVER_H
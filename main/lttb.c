@@ -0,0 +1,119 @@
+#include "lttb.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#define LTTB_NO_BUCKET SIZE_MAX
+
+void lttb_begin(lttb_t *lttb, size_t n, size_t points)
+{
+    if (points < 3) {
+        points = 3;
+    } else if (points > LTTB_MAX_POINTS) {
+        points = LTTB_MAX_POINTS;
+    }
+    lttb->n = n;
+    lttb->points = points;
+    // the first and the last sample are points of their own, the others are split into points - 2 buckets
+    lttb->every = (double)(n - 2) / (points - 2);
+    lttb->pass = 1;
+    lttb->index = 0;
+    lttb->bucket = LTTB_NO_BUCKET;
+    memset(lttb->avg_t, 0, sizeof(lttb->avg_t[0]) * (points - 2));
+    memset(lttb->avg_temp, 0, sizeof(lttb->avg_temp[0]) * (points - 2));
+    memset(lttb->count, 0, sizeof(lttb->count[0]) * (points - 2));
+}
+
+/* Bucket of a sample between the first and the last, samples that showed up since the count go to the last bucket */
+static size_t bucket_of(const lttb_t *lttb, size_t index)
+{
+    size_t bucket = (size_t)((index - 1) / lttb->every);
+    return bucket < lttb->points - 2 ? bucket : lttb->points - 3;
+}
+
+void lttb_scan(lttb_t *lttb, const history_sample_t *samples, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        size_t index = lttb->index++;
+        lttb->last = samples[i];
+        if (index == 0 || index >= lttb->n - 1) {
+            continue;
+        }
+        size_t bucket = bucket_of(lttb, index);
+        lttb->avg_t[bucket] += (double)samples[i].t_ms;
+        lttb->avg_temp[bucket] += samples[i].temp;
+        lttb->count[bucket]++;
+    }
+}
+
+static void start_select(lttb_t *lttb)
+{
+    for (size_t b = 0; b < lttb->points - 2; ++b) {
+        if (lttb->count[b]) {
+            lttb->avg_t[b] /= lttb->count[b];
+            lttb->avg_temp[b] /= lttb->count[b];
+        }
+    }
+    lttb->end = lttb->last;
+    lttb->pass = 2;
+    lttb->index = 0;
+}
+
+/* Twice the area of the triangle between the last pick, the candidate and the average of the next bucket */
+static double area_with_next(const lttb_t *lttb, size_t bucket, const history_sample_t *s)
+{
+    double next_t = (double)lttb->end.t_ms;
+    double next_temp = lttb->end.temp;
+    if (bucket + 1 < lttb->points - 2 && lttb->count[bucket + 1]) {
+        next_t = lttb->avg_t[bucket + 1];
+        next_temp = lttb->avg_temp[bucket + 1];
+    }
+    double a_t = (double)lttb->a.t_ms;
+    return fabs((a_t - next_t) * (s->temp - lttb->a.temp) - (a_t - (double)s->t_ms) * (next_temp - lttb->a.temp));
+}
+
+size_t lttb_select(lttb_t *lttb, const history_sample_t *samples, size_t count, history_sample_t *out)
+{
+    size_t n = 0;
+    if (lttb->pass == 1) {
+        start_select(lttb);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        size_t index = lttb->index++;
+        lttb->last = samples[i];
+        if (index == 0) {
+            out[n++] = lttb->a = samples[i];
+            continue;
+        }
+        if (index >= lttb->n - 1) {
+            continue; // the last sample, lttb_finish() adds it
+        }
+        size_t bucket = bucket_of(lttb, index);
+        if (bucket != lttb->bucket) {
+            if (lttb->bucket != LTTB_NO_BUCKET) {
+                out[n++] = lttb->a = lttb->best;
+            }
+            lttb->bucket = bucket;
+            lttb->best_area = -1.0;
+        }
+        double area = area_with_next(lttb, bucket, &samples[i]);
+        if (area > lttb->best_area) {
+            lttb->best_area = area;
+            lttb->best = samples[i];
+        }
+    }
+    return n;
+}
+
+size_t lttb_finish(lttb_t *lttb, history_sample_t *out)
+{
+    size_t n = 0;
+    if (lttb->bucket != LTTB_NO_BUCKET) {
+        out[n++] = lttb->best;
+    }
+    if (lttb->index > 1) {
+        out[n++] = lttb->last;
+    }
+    return n;
+}
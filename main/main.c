@@ -66,7 +66,7 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
-    thermostat_init();    // создаёт mutex и задачу датчика
+    thermostat_init();    // создаёт задачу датчика
     wifi_init_softap();
     start_webserver();
 
@@ -0,0 +1,185 @@
+#include "rollup.h"
+
+#include <stdbool.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "tslog.h"
+
+static const char *TAG = "ROLLUP";
+
+/*
+ * Every tier is a ring of fixed-period buckets with min, max, sum and count of the samples in them,
+ * in 1/16 C like the history. A bucket is identified by its start time divided by the period.
+ */
+typedef struct {
+    uint32_t index;         // t / period
+    int32_t sum_x16;
+    int16_t min_x16;
+    int16_t max_x16;
+    uint32_t count;
+} rollup_bucket_t;
+
+typedef struct {
+    uint32_t period_ms;
+    uint32_t capacity;
+    rollup_bucket_t *ring;
+    uint32_t total;         // buckets ever started, the newest has index total - 1
+} rollup_tier_t;
+
+static rollup_bucket_t s_ring_1m[720];
+static rollup_bucket_t s_ring_15m[672];
+static rollup_bucket_t s_ring_1h[720];
+
+static rollup_tier_t s_tiers[ROLLUP_TIERS] = {
+    { .period_ms = 60 * 1000, .capacity = 720, .ring = s_ring_1m },
+    { .period_ms = 15 * 60 * 1000, .capacity = 672, .ring = s_ring_15m },
+    { .period_ms = 60 * 60 * 1000, .capacity = 720, .ring = s_ring_1h },
+};
+static SemaphoreHandle_t s_mutex = NULL;
+
+static inline uint32_t oldest_index(const rollup_tier_t *tier)
+{
+    return tier->total > tier->capacity ? tier->total - tier->capacity : 0;
+}
+
+static void add_sample(uint64_t t_ms, int16_t temp_x16)
+{
+    for (int i = 0; i < ROLLUP_TIERS; ++i) {
+        rollup_tier_t *tier = &s_tiers[i];
+        uint32_t index = (uint32_t)(t_ms / tier->period_ms);
+        rollup_bucket_t *bucket = &tier->ring[(tier->total - 1) % tier->capacity];
+        if (tier->total == 0 || bucket->index != index) {
+            bucket = &tier->ring[tier->total++ % tier->capacity];
+            *bucket = (rollup_bucket_t) {
+                .index = index,
+                .min_x16 = temp_x16,
+                .max_x16 = temp_x16,
+            };
+        }
+        bucket->sum_x16 += temp_x16;
+        bucket->count++;
+        if (temp_x16 < bucket->min_x16) {
+            bucket->min_x16 = temp_x16;
+        }
+        if (temp_x16 > bucket->max_x16) {
+            bucket->max_x16 = temp_x16;
+        }
+    }
+}
+
+void rollup_init(void)
+{
+    if (s_mutex != NULL) {
+        return;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    configASSERT(s_mutex);
+
+    // Nothing else runs yet, the log is replayed without holding the mutex
+    tslog_cursor_t cursor;
+    history_sample_t samples[32];
+    size_t n, total = 0;
+    tslog_cursor_init(&cursor, 0);
+    while ((n = tslog_read(&cursor, 0, UINT64_MAX, samples, 32)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            add_sample(samples[i].t_ms, (int16_t)lroundf(samples[i].temp * 16.0f));
+        }
+        total += n;
+    }
+    ESP_LOGI(TAG, "%u sample(s) replayed from the log", (unsigned)total);
+}
+
+void rollup_add(uint64_t t_ms, float temp)
+{
+    float scaled = fminf(fmaxf(temp * 16.0f, INT16_MIN), INT16_MAX);
+    int16_t temp_x16 = (int16_t)lroundf(scaled);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    add_sample(t_ms, temp_x16);
+    xSemaphoreGive(s_mutex);
+}
+
+uint32_t rollup_period_ms(int tier)
+{
+    return s_tiers[tier].period_ms;
+}
+
+static size_t count_locked(const rollup_tier_t *tier, uint64_t from_ms, uint64_t to_ms)
+{
+    size_t count = 0;
+    for (uint32_t i = oldest_index(tier); i < tier->total; ++i) {
+        uint64_t t = (uint64_t)tier->ring[i % tier->capacity].index * tier->period_ms;
+        if (t > to_ms) {
+            break;
+        }
+        if (t >= from_ms) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t rollup_count(int tier, uint64_t from_ms, uint64_t to_ms)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    size_t count = count_locked(&s_tiers[tier], from_ms, to_ms);
+    xSemaphoreGive(s_mutex);
+    return count;
+}
+
+int rollup_pick_tier(uint64_t from_ms, uint64_t to_ms, size_t max)
+{
+    int picked = ROLLUP_TIERS - 1;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (int i = 0; i < ROLLUP_TIERS; ++i) {
+        const rollup_tier_t *tier = &s_tiers[i];
+        // a tier that has never dropped a bucket holds everything since the start of the log
+        bool covers = tier->total <= tier->capacity ||
+                      (uint64_t)tier->ring[oldest_index(tier) % tier->capacity].index * tier->period_ms <= from_ms;
+        if (covers && count_locked(tier, from_ms, to_ms) <= max) {
+            picked = i;
+            break;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    return picked;
+}
+
+void rollup_cursor_init(rollup_cursor_t *cursor, int tier)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    cursor->tier = tier;
+    cursor->index = oldest_index(&s_tiers[tier]);
+    xSemaphoreGive(s_mutex);
+}
+
+size_t rollup_read(rollup_cursor_t *cursor, uint64_t from_ms, uint64_t to_ms, rollup_point_t *out, size_t max)
+{
+    size_t n = 0;
+    const rollup_tier_t *tier = &s_tiers[cursor->tier];
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (cursor->index < oldest_index(tier)) {
+        cursor->index = oldest_index(tier); // the ring moved past this reader
+    }
+    while (n < max && cursor->index < tier->total) {
+        const rollup_bucket_t *bucket = &tier->ring[cursor->index % tier->capacity];
+        uint64_t t = (uint64_t)bucket->index * tier->period_ms;
+        if (t > to_ms) {
+            break;
+        }
+        if (t >= from_ms) {
+            out[n++] = (rollup_point_t) {
+                .t_ms = t,
+                .min = bucket->min_x16 / 16.0f,
+                .max = bucket->max_x16 / 16.0f,
+                .avg = (float)bucket->sum_x16 / bucket->count / 16.0f,
+            };
+        }
+        cursor->index++;
+    }
+    xSemaphoreGive(s_mutex);
+    return n;
+}
@@ -0,0 +1,91 @@
+#include "sample_bus.h"
+
+#include <stdatomic.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "SAMPLE_BUS";
+
+/*
+ * One single-producer single-consumer ring per subscriber: only the sensor task moves head,
+ * only the subscriber moves tail, so neither side ever takes a lock.
+ */
+struct sample_bus_sub {
+    const char *name;
+    TaskHandle_t task;
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_uint overruns;
+    sample_t ring[SAMPLE_BUS_RING_LEN];
+};
+
+_Static_assert((SAMPLE_BUS_RING_LEN & (SAMPLE_BUS_RING_LEN - 1)) == 0, "ring length must be a power of two");
+
+static struct sample_bus_sub s_subs[SAMPLE_BUS_MAX_SUBSCRIBERS];
+static atomic_uint s_count = 0;     // subscribers the publisher sees, each one complete before it is counted
+static portMUX_TYPE s_subscribe_lock = portMUX_INITIALIZER_UNLOCKED;
+
+sample_bus_sub_t *sample_bus_subscribe(const char *name)
+{
+    sample_bus_sub_t *sub = NULL;
+    portENTER_CRITICAL(&s_subscribe_lock);
+    unsigned count = atomic_load(&s_count);
+    if (count < SAMPLE_BUS_MAX_SUBSCRIBERS) {
+        sub = &s_subs[count];
+        sub->name = name;
+        sub->task = xTaskGetCurrentTaskHandle();
+        atomic_store(&sub->head, 0);
+        atomic_store(&sub->tail, 0);
+        atomic_store(&sub->overruns, 0);
+        atomic_store_explicit(&s_count, count + 1, memory_order_release);
+    }
+    portEXIT_CRITICAL(&s_subscribe_lock);
+    if (sub == NULL) {
+        ESP_LOGE(TAG, "No room for subscriber %s", name);
+    }
+    return sub;
+}
+
+void sample_bus_publish(const sample_t *sample)
+{
+    unsigned count = atomic_load_explicit(&s_count, memory_order_acquire);
+    for (unsigned i = 0; i < count; ++i) {
+        sample_bus_sub_t *sub = &s_subs[i];
+        unsigned head = atomic_load_explicit(&sub->head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(&sub->tail, memory_order_acquire);
+        if (head - tail >= SAMPLE_BUS_RING_LEN) {
+            unsigned overruns = atomic_fetch_add(&sub->overruns, 1) + 1;
+            if (overruns == 1 || overruns % 100 == 0) {
+                ESP_LOGW(TAG, "%s is behind, %u sample(s) missed", sub->name, overruns);
+            }
+        } else {
+            sub->ring[head % SAMPLE_BUS_RING_LEN] = *sample;
+            atomic_store_explicit(&sub->head, head + 1, memory_order_release);
+        }
+        xTaskNotifyGive(sub->task);
+    }
+}
+
+bool sample_bus_take(sample_bus_sub_t *sub, sample_t *sample)
+{
+    unsigned tail = atomic_load_explicit(&sub->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&sub->head, memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    *sample = sub->ring[tail % SAMPLE_BUS_RING_LEN];
+    atomic_store_explicit(&sub->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool sample_bus_overruns(unsigned index, const char **name, uint32_t *overruns)
+{
+    if (index >= atomic_load_explicit(&s_count, memory_order_acquire)) {
+        return false;
+    }
+    *name = s_subs[index].name;
+    *overruns = atomic_load(&s_subs[index].overruns);
+    return true;
+}
@@ -0,0 +1,55 @@
+#include "sensor_cache.h"
+#include <string.h>
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+
+static const char *TAG = "SENSOR_CACHE";
+
+#define SENSOR_CACHE_NAMESPACE "storage"
+#define SENSOR_CACHE_KEY       "sensors"
+#define SENSOR_CACHE_MAX       8
+
+int sensor_cache_load(sensor_cache_entry_t *entries, int max_entries)
+{
+    nvs_handle_t handle;
+    if (nvs_open(SENSOR_CACHE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open NVS");
+        return 0;
+    }
+    size_t size = max_entries * sizeof(sensor_cache_entry_t);
+    esp_err_t err = nvs_get_blob(handle, SENSOR_CACHE_KEY, entries, &size);
+    nvs_close(handle);
+    if (err != ESP_OK || size % sizeof(sensor_cache_entry_t) != 0) {
+        ESP_LOGI(TAG, "No cached sensors");
+        return 0;
+    }
+    return size / sizeof(sensor_cache_entry_t);
+}
+
+void sensor_cache_save(const sensor_cache_entry_t *entries, int count)
+{
+    sensor_cache_entry_t stored[SENSOR_CACHE_MAX];
+    if (count > SENSOR_CACHE_MAX) {
+        count = SENSOR_CACHE_MAX;
+    }
+    // Same list as before: no flash write
+    if (sensor_cache_load(stored, SENSOR_CACHE_MAX) == count &&
+            memcmp(stored, entries, count * sizeof(sensor_cache_entry_t)) == 0) {
+        return;
+    }
+
+    nvs_handle_t handle;
+    if (nvs_open(SENSOR_CACHE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open NVS");
+        return;
+    }
+    if (count > 0) {
+        nvs_set_blob(handle, SENSOR_CACHE_KEY, entries, count * sizeof(sensor_cache_entry_t));
+    } else {
+        nvs_erase_key(handle, SENSOR_CACHE_KEY);
+    }
+    nvs_commit(handle);
+    nvs_close(handle);
+    ESP_LOGI(TAG, "Cached %d sensor(s)", count);
+}
@@ -0,0 +1,287 @@
+#include "settings_parser.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "thermostat.h"
+
+/* DS18B20 measuring range, thresholds outside of it can never be reached */
+#define LIMIT_MIN (-55.0f)
+#define LIMIT_MAX 125.0f
+
+enum {
+    ST_OBJ_START,
+    ST_FIRST_KEY_OR_END,
+    ST_NEXT_KEY,
+    ST_KEY,
+    ST_COLON,
+    ST_VALUE,
+    ST_ARRAY_FIRST,         // right after '[', a value or ']'
+    ST_ARRAY_NEXT,          // right after ',', a value
+    ST_ARRAY_COMMA_OR_END,
+    ST_OBJ_COMMA_OR_END,
+    ST_NUMBER,
+    ST_STRING,
+    ST_LITERAL,
+    ST_DONE,
+    ST_ERROR,
+};
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool token_push(settings_parser_t *p, char c)
+{
+    if (p->token_len + 1 >= sizeof(p->token)) {
+        return false;
+    }
+    p->token[p->token_len++] = c;
+    p->token[p->token_len] = '\0';
+    return true;
+}
+
+/* A scalar is complete, continue in the object or array that holds it */
+static int after_scalar(settings_parser_t *p, bool in_array)
+{
+    return in_array ? ST_ARRAY_COMMA_OR_END : ST_OBJ_COMMA_OR_END;
+}
+
+static int finish_number(settings_parser_t *p, bool in_array)
+{
+    char *end = NULL;
+    float value = strtof(p->token, &end);
+    if (p->token_len == 0 || *end != '\0') {
+        return ST_ERROR;
+    }
+    if (p->in_limits) {
+        if (!in_array || p->array_index >= 5) {
+            return ST_ERROR;
+        }
+        p->update.limits[p->array_index++] = value;
+    }
+    if (p->in_period) {
+        // whole milliseconds only, anything else is left for settings_parser_finish() to refuse
+        if (in_array || value != floorf(value) || value < 0.0f || value > (float)UINT32_MAX) {
+            p->update.period_ms = 0;
+        } else {
+            p->update.period_ms = (uint32_t)value;
+        }
+        p->update.has_period = true;
+    }
+    return after_scalar(p, in_array);
+}
+
+static int finish_array(settings_parser_t *p)
+{
+    if (p->in_limits) {
+        if (p->array_index != 5) {
+            return ST_ERROR;
+        }
+        p->update.has_limits = true;
+    }
+    return ST_OBJ_COMMA_OR_END;
+}
+
+/* First character of a value, in an object member or an array element */
+static int start_value(settings_parser_t *p, char c, bool in_array)
+{
+    p->token_len = 0;
+    p->token[0] = '\0';
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        token_push(p, c);
+        return ST_NUMBER;
+    }
+    if (p->in_limits || p->in_period) {
+        return ST_ERROR; // both only hold numbers
+    }
+    if (c == '"') {
+        p->escape = false;
+        return ST_STRING;
+    }
+    if (c >= 'a' && c <= 'z') {
+        token_push(p, c);
+        return ST_LITERAL;
+    }
+    return ST_ERROR;
+}
+
+void settings_parser_init(settings_parser_t *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->state = ST_OBJ_START;
+}
+
+settings_parse_status_t settings_parser_feed(settings_parser_t *parser, const char *data, size_t len)
+{
+    settings_parser_t *p = parser;
+    size_t i = 0;
+    while (i < len && p->state != ST_ERROR) {
+        char c = data[i];
+        bool in_array = p->after_value == ST_ARRAY_COMMA_OR_END;
+        switch (p->state) {
+        case ST_OBJ_START:
+            if (!is_space(c)) {
+                p->state = c == '{' ? ST_FIRST_KEY_OR_END : ST_ERROR;
+            }
+            break;
+        case ST_FIRST_KEY_OR_END:
+        case ST_NEXT_KEY:
+            if (is_space(c)) {
+                break;
+            }
+            if (c == '"') {
+                p->token_len = 0;
+                p->token[0] = '\0';
+                p->escape = false;
+                p->state = ST_KEY;
+            } else if (c == '}' && p->state == ST_FIRST_KEY_OR_END) {
+                p->state = ST_DONE;
+            } else {
+                p->state = ST_ERROR;
+            }
+            break;
+        case ST_KEY:
+            if (p->escape) {
+                p->escape = false;  // the escaped character, a quote included, is part of the key
+            } else if (c == '"') {
+                p->in_limits = strcmp(p->token, "limits") == 0;
+                p->in_period = strcmp(p->token, "period_ms") == 0;
+                p->state = ST_COLON;
+            } else if (c == '\\' || !token_push(p, c)) {
+                // none of our keys needs escapes, and none is that long: not one of ours
+                p->escape = c == '\\';
+                p->token[0] = '\0';
+                p->token_len = sizeof(p->token);
+            }
+            break;
+        case ST_COLON:
+            if (!is_space(c)) {
+                p->after_value = ST_OBJ_COMMA_OR_END;
+                p->state = c == ':' ? ST_VALUE : ST_ERROR;
+            }
+            break;
+        case ST_VALUE:
+            if (is_space(c)) {
+                break;
+            }
+            if (c == '[' && p->in_period) {
+                p->state = ST_ERROR;
+            } else if (c == '[') {
+                p->array_index = 0;
+                p->after_value = ST_ARRAY_COMMA_OR_END;
+                p->state = ST_ARRAY_FIRST;
+            } else {
+                p->state = start_value(p, c, false);
+            }
+            break;
+        case ST_ARRAY_FIRST:
+        case ST_ARRAY_NEXT:
+            if (is_space(c)) {
+                break;
+            }
+            if (c == ']' && p->state == ST_ARRAY_FIRST) {
+                p->after_value = ST_OBJ_COMMA_OR_END;
+                p->state = finish_array(p);
+            } else {
+                p->state = start_value(p, c, true); // nested arrays and objects end up as errors here
+            }
+            break;
+        case ST_ARRAY_COMMA_OR_END:
+            if (is_space(c)) {
+                break;
+            }
+            if (c == ',') {
+                p->state = ST_ARRAY_NEXT;
+            } else if (c == ']') {
+                p->after_value = ST_OBJ_COMMA_OR_END;
+                p->state = finish_array(p);
+            } else {
+                p->state = ST_ERROR;
+            }
+            break;
+        case ST_OBJ_COMMA_OR_END:
+            if (is_space(c)) {
+                break;
+            }
+            if (c == ',') {
+                p->state = ST_NEXT_KEY;
+            } else if (c == '}') {
+                p->state = ST_DONE;
+            } else {
+                p->state = ST_ERROR;
+            }
+            break;
+        case ST_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                if (!token_push(p, c)) {
+                    p->state = ST_ERROR;
+                }
+                break;
+            }
+            // the number ends at the first other character, which is handled in the next state
+            p->state = finish_number(p, in_array);
+            continue;
+        case ST_STRING:
+            if (p->escape) {
+                p->escape = false;
+            } else if (c == '\\') {
+                p->escape = true;
+            } else if (c == '"') {
+                p->state = after_scalar(p, in_array);
+            }
+            break;
+        case ST_LITERAL:
+            if (c >= 'a' && c <= 'z') {
+                if (!token_push(p, c)) {
+                    p->state = ST_ERROR;
+                }
+                break;
+            }
+            if (strcmp(p->token, "true") && strcmp(p->token, "false") && strcmp(p->token, "null")) {
+                p->state = ST_ERROR;
+                break;
+            }
+            p->state = after_scalar(p, in_array);
+            continue;
+        case ST_DONE:
+            if (!is_space(c)) {
+                p->state = ST_ERROR;
+            }
+            break;
+        }
+        i++;
+    }
+
+    if (p->state == ST_ERROR) {
+        return SETTINGS_PARSE_ERROR;
+    }
+    return p->state == ST_DONE ? SETTINGS_PARSE_DONE : SETTINGS_PARSE_MORE;
+}
+
+const char *settings_parser_finish(settings_parser_t *parser, settings_update_t *update)
+{
+    if (parser->state != ST_DONE) {
+        return "Malformed JSON";
+    }
+    if (!parser->update.has_limits && !parser->update.has_period) {
+        return "Nothing to update";
+    }
+    if (parser->update.has_period && (parser->update.period_ms < THERMOSTAT_PERIOD_MIN_MS ||
+                                      parser->update.period_ms > THERMOSTAT_PERIOD_MAX_MS)) {
+        return "Sample period out of range";
+    }
+    const float *limits = parser->update.limits;
+    for (int i = 0; parser->update.has_limits && i < 5; ++i) {
+        if (!isfinite(limits[i]) || limits[i] < LIMIT_MIN || limits[i] > LIMIT_MAX) {
+            return "Threshold out of range";
+        }
+        if (i > 0 && limits[i] < limits[i - 1]) {
+            return "Thresholds must be in ascending order";
+        }
+    }
+    *update = parser->update;
+    return NULL;
+}
@@ -0,0 +1,158 @@
+#include "settings_store.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "thermostat.h"
+
+static const char *TAG = "SETTINGS";
+
+/* A save waits for this much quiet after the last change, but never longer than the maximum */
+#define SETTINGS_STORE_DEBOUNCE_MS 1000
+#define SETTINGS_STORE_MAX_DELAY_MS 5000
+
+#define SETTINGS_NAMESPACE "storage"
+#define SETTINGS_KEY "settings"
+#define SETTINGS_LEGACY_KEY "thresholds"     // bare float[5] blob of older firmware
+#define SETTINGS_RECORD_VERSION 1
+
+/* The whole settings record is one blob, read at boot with a single nvs_get_blob() */
+typedef struct {
+    uint16_t version;
+    uint16_t size;          // sizeof(settings_record_t) when it was written
+    uint32_t generation;
+    float thresholds[5];
+    uint32_t period_ms;
+    uint32_t crc;           // crc32 of everything before it
+} settings_record_t;
+
+static TaskHandle_t s_task = NULL;
+
+static uint32_t record_crc(const settings_record_t *record)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)record, offsetof(settings_record_t, crc));
+}
+
+static bool record_valid(const settings_record_t *record, size_t size)
+{
+    return size == sizeof(*record) && record->version == SETTINGS_RECORD_VERSION &&
+           record->size == sizeof(*record) && record->crc == record_crc(record) &&
+           record->period_ms >= THERMOSTAT_PERIOD_MIN_MS && record->period_ms <= THERMOSTAT_PERIOD_MAX_MS;
+}
+
+static void load_settings(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(SETTINGS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open NVS");
+        return;
+    }
+    settings_record_t record;
+    size_t size = sizeof(record);
+    esp_err_t err = nvs_get_blob(handle, SETTINGS_KEY, &record, &size);
+    if (err == ESP_OK && record_valid(&record, size)) {
+        thermostat_restore_settings(record.thresholds, record.period_ms, record.generation);
+        ESP_LOGI(TAG, "Settings generation %lu loaded", (unsigned long)record.generation);
+        nvs_close(handle);
+        return;
+    }
+    if (err == ESP_OK || err == ESP_ERR_NVS_INVALID_LENGTH) {
+        ESP_LOGW(TAG, "Saved settings are corrupt or from a newer firmware, ignored");
+    }
+
+    // older firmware only saved the thresholds: take them over as generation 1, the next save migrates them
+    float thresholds[5];
+    size = sizeof(thresholds);
+    err = nvs_get_blob(handle, SETTINGS_LEGACY_KEY, thresholds, &size);
+    if (err == ESP_OK && size == sizeof(thresholds)) {
+        thermostat_restore_settings(thresholds, THERMOSTAT_PERIOD_DEFAULT_MS, 1);
+        settings_store_mark_dirty();
+        ESP_LOGI(TAG, "Migrating saved thresholds");
+    } else {
+        ESP_LOGI(TAG, "No saved thresholds, using defaults");
+    }
+    nvs_close(handle);
+}
+
+static void save_settings(const thermostat_state_t *state)
+{
+    nvs_handle_t handle;
+    if (nvs_open(SETTINGS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open NVS");
+        return;
+    }
+    settings_record_t record = {
+        .version = SETTINGS_RECORD_VERSION,
+        .size = sizeof(record),
+        .generation = state->generation,
+        .period_ms = state->period_ms,
+    };
+    memcpy(record.thresholds, state->thresholds, sizeof(record.thresholds));
+    record.crc = record_crc(&record);
+
+    // rewriting the same record would still cost a flash write
+    settings_record_t stored;
+    size_t size = sizeof(stored);
+    if (nvs_get_blob(handle, SETTINGS_KEY, &stored, &size) == ESP_OK && size == sizeof(stored) &&
+            memcmp(&stored, &record, sizeof(stored)) == 0) {
+        ESP_LOGD(TAG, "Settings unchanged, nothing to save");
+        nvs_close(handle);
+        return;
+    }
+    esp_err_t err = nvs_set_blob(handle, SETTINGS_KEY, &record, sizeof(record));
+    if (err == ESP_OK) {
+        err = nvs_erase_key(handle, SETTINGS_LEGACY_KEY);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save settings: %s", esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "Settings generation %lu saved", (unsigned long)record.generation);
+    }
+    nvs_close(handle);
+}
+
+static void settings_store_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // every change in the burst restarts the quiet period
+        TickType_t start = xTaskGetTickCount();
+        while (xTaskGetTickCount() - start < pdMS_TO_TICKS(SETTINGS_STORE_MAX_DELAY_MS) &&
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SETTINGS_STORE_DEBOUNCE_MS)) > 0) {
+        }
+        // whatever is published now, the values of the last change included
+        thermostat_state_t state;
+        thermostat_state_read(&state);
+        save_settings(&state);
+    }
+}
+
+void settings_store_init(void)
+{
+    if (s_task != NULL) {
+        return;
+    }
+    // lowest priority: NVS writes wait for everything else
+    if (xTaskCreate(settings_store_task, "settings_store", 3072, NULL, 1, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create settings store task");
+    }
+    load_settings();
+}
+
+void settings_store_mark_dirty(void)
+{
+    if (s_task != NULL) {
+        xTaskNotifyGive(s_task);
+    }
+}
@@ -0,0 +1,113 @@
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "binfmt.h"
+#include "history.h"
+#include "thermostat.h"
+
+/*
+ * Two pre-rendered payloads: the writer always fills the one readers are not pointed at, then flips s_current.
+ * Each slot has its own sequence number (odd while it is being written), so a reader that was still copying
+ * a slot when it got reused two publishes later notices and copies again.
+ */
+typedef struct {
+    atomic_uint seq;
+    uint32_t sample_seq;    // sequence number of the payload, as in "seq"
+    size_t len;
+    char data[SNAPSHOT_MAX_LEN];
+    uint8_t bin[BINFMT_HEADER_SIZE + BINFMT_DATA_RECORD_SIZE];
+} snapshot_slot_t;
+
+static snapshot_slot_t s_slots[2];
+static atomic_int s_current = 0;
+static SemaphoreHandle_t s_publish_mutex = NULL;
+/* Writer side only, under s_publish_mutex */
+static uint32_t s_sample_seq = 0;
+static char s_last_body[SNAPSHOT_MAX_LEN];
+
+void snapshot_init(void)
+{
+    if (s_publish_mutex == NULL) {
+        s_publish_mutex = xSemaphoreCreateMutex();
+        configASSERT(s_publish_mutex);
+    }
+}
+
+bool snapshot_publish(void)
+{
+    xSemaphoreTake(s_publish_mutex, portMAX_DELAY);
+    // read under the mutex: of two racing publishers, the one that renders last saw the newest state
+    thermostat_state_t state;
+    thermostat_state_read(&state);
+    float temp = state.temperature;
+    const float *thresholds = state.thresholds;
+    char body[SNAPSHOT_MAX_LEN];
+    // limits in full, the page has to compare against exactly what the firmware does
+    snprintf(body, sizeof(body), "\"temp\":%.2f,\"limits\":[%g,%g,%g,%g,%g],\"period_ms\":%lu,\"gen\":%lu",
+             temp, thresholds[0], thresholds[1], thresholds[2], thresholds[3], thresholds[4],
+             (unsigned long)state.period_ms, (unsigned long)state.generation);
+
+    // a sample that renders the same keeps its sequence number, so cached copies stay valid
+    if (s_sample_seq != 0 && strcmp(body, s_last_body) == 0) {
+        xSemaphoreGive(s_publish_mutex);
+        return false;
+    }
+    strcpy(s_last_body, body);
+    s_sample_seq++;
+
+    int next = !atomic_load(&s_current);
+    snapshot_slot_t *slot = &s_slots[next];
+    atomic_fetch_add(&slot->seq, 1);
+    int len = snprintf(slot->data, sizeof(slot->data), "{\"seq\":%lu,%s}", (unsigned long)s_sample_seq, body);
+    slot->len = (len > 0 && len < (int)sizeof(slot->data)) ? (size_t)len : 0;
+    slot->sample_seq = s_sample_seq;
+    uint8_t *p = binfmt_put_header(slot->bin, BINFMT_KIND_DATA, BINFMT_DATA_RECORD_SIZE);
+    p = binfmt_put_u32(p, s_sample_seq);
+    p = binfmt_put_u64(p, history_now_ms());
+    p = binfmt_put_f32(p, temp);
+    for (int i = 0; i < 5; ++i) {
+        p = binfmt_put_f32(p, thresholds[i]);
+    }
+    p = binfmt_put_u32(p, state.generation);
+    binfmt_put_u32(p, state.period_ms);
+    atomic_fetch_add(&slot->seq, 1);
+    atomic_store(&s_current, next);
+
+    xSemaphoreGive(s_publish_mutex);
+    return true;
+}
+
+size_t snapshot_read(snapshot_format_t format, void *buf, size_t size, uint32_t *sample_seq)
+{
+    size_t len;
+    uint32_t copied_seq;
+    unsigned seq;
+    do {
+        const snapshot_slot_t *slot = &s_slots[atomic_load(&s_current)];
+        seq = atomic_load(&slot->seq);
+        if (seq & 1) {
+            continue;
+        }
+        if (format == SNAPSHOT_BINARY) {
+            len = (slot->len && sizeof(slot->bin) <= size) ? sizeof(slot->bin) : 0;
+            memcpy(buf, slot->bin, len);
+        } else {
+            len = slot->len < size ? slot->len : 0;
+            memcpy(buf, slot->data, len);
+        }
+        copied_seq = slot->sample_seq;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load(&slot->seq) == seq) {
+            break;
+        }
+    } while (1);
+    if (sample_seq) {
+        *sample_seq = copied_seq;
+    }
+    return len;
+}
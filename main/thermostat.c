@@ -1,9 +1,20 @@
 #include "thermostat.h"
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "sdkconfig.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "onewire_bus.h"
 #include "ds18b20.h"
+#include "sensor_cache.h"
+#include "snapshot.h"
+#include "history.h"
+#include "tslog.h"
+#include "rollup.h"
+#include "sample_bus.h"
 
 static const char *TAG = "THERMOSTAT";
 
@@ -15,59 +26,165 @@ static const char *TAG = "THERMOSTAT";
 #define LED_ORANGE GPIO_NUM_12
 #define LED_RED    GPIO_NUM_14
 
-/* Global definitions (actual storage) */
-led_settings_t g_settings = {
-    .thresholds = {20.0f, 22.0f, 25.0f, 28.0f, 32.0f}
+#define THERMOSTAT_MAX_SENSORS 8
+/* In monitoring mode every probe is still read in full once per this many conversions */
+#define THERMOSTAT_FULL_READ_INTERVAL 30
+/* Probes attached from the cache are complemented by a ROM search once per this many conversions */
+#define THERMOSTAT_SEARCH_INTERVAL 600
+/* DS18B20 measuring range, also the widest possible alarm window */
+#define DS18B20_ALARM_MIN (-55)
+#define DS18B20_ALARM_MAX 125
+
+/* Resolution policy: a probe close to a threshold or moving quickly converts at full resolution */
+#define RESOLUTION_FAST_RATE   0.02f  // C/s
+#define RESOLUTION_HYSTERESIS  0.25f  // C, extra distance needed before lowering the resolution
+#define RESOLUTION_RATE_WINDOW_US (10 * 1000 * 1000)
+/* Sampling: time kept free in every period for the scratchpad reads after a conversion, and how often jitter is logged */
+#define THERMOSTAT_BUS_MARGIN_MS 100
+#define THERMOSTAT_CADENCE_REPORT 60
+
+/*
+ * Published state, a seqlock: s_state_seq is odd while a writer is in the middle of an update.
+ * The spinlock only orders the writers (sensor task and web handlers), readers never take it.
+ */
+static thermostat_state_t s_state = {
+    .thresholds = {20.0f, 22.0f, 25.0f, 28.0f, 32.0f},
+    .period_ms = THERMOSTAT_PERIOD_DEFAULT_MS,
 };
-SemaphoreHandle_t settings_mutex = NULL;
-float current_temperature = 0.0f;
+static atomic_uint s_state_seq = 0;
+static portMUX_TYPE s_state_lock = portMUX_INITIALIZER_UNLOCKED;
 
 static const gpio_num_t led_gpios[5] = {
     LED_BLUE, LED_GREEN, LED_YELLOW, LED_ORANGE, LED_RED
 };
 
-static void update_leds_internal(float temp)
+/* Index of the highest threshold that is <= temp, -1 below all of them */
+static int temperature_band(float temp, const float thresholds[5])
 {
-    int active = -1;
-    // choose highest threshold that is <= temp
     for (int i = 4; i >= 0; --i) {
-        if (temp >= g_settings.thresholds[i]) {
-            active = i;
-            break;
+        if (temp >= thresholds[i]) {
+            return i;
         }
     }
+    return -1;
+}
+
+static void update_leds(float temp, const float thresholds[5])
+{
+    int active = temperature_band(temp, thresholds);
     for (int i = 0; i < 5; ++i) {
         gpio_set_level(led_gpios[i], (i == active) ? 1 : 0);
     }
 }
 
-void update_leds(float temp)
+static void state_write_begin(void)
 {
-    if (settings_mutex) {
-        if (xSemaphoreTake(settings_mutex, pdMS_TO_TICKS(5000)) == pdTRUE) {
-            update_leds_internal(temp);
-            xSemaphoreGive(settings_mutex);
-        } else {
-            ESP_LOGW(TAG, "update_leds: mutex take timed out");
-            update_leds_internal(temp); // best-effort
+    portENTER_CRITICAL(&s_state_lock);
+    atomic_fetch_add_explicit(&s_state_seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void state_write_end(void)
+{
+    atomic_fetch_add_explicit(&s_state_seq, 1, memory_order_release);
+    portEXIT_CRITICAL(&s_state_lock);
+}
+
+void thermostat_state_read(thermostat_state_t *state)
+{
+    unsigned seq;
+    do {
+        seq = atomic_load_explicit(&s_state_seq, memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        *state = s_state;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s_state_seq, memory_order_relaxed) == seq) {
+            break;
         }
+    } while (1);
+}
+
+uint32_t thermostat_publish_sample(float temperature)
+{
+    state_write_begin();
+    s_state.temperature = temperature;
+    uint32_t seq = ++s_state.sample_seq;
+    state_write_end();
+    return seq;
+}
+
+bool thermostat_publish_settings(const float thresholds[5], uint32_t period_ms, uint32_t if_generation,
+                                 uint32_t *generation, bool *changed)
+{
+    bool ok = true;
+    *changed = false;
+    state_write_begin();
+    if (if_generation != THERMOSTAT_ANY_GENERATION && if_generation != s_state.generation) {
+        ok = false;
     } else {
-        update_leds_internal(temp);
+        if (thresholds && memcmp(s_state.thresholds, thresholds, sizeof(s_state.thresholds)) != 0) {
+            memcpy(s_state.thresholds, thresholds, sizeof(s_state.thresholds));
+            *changed = true;
+        }
+        if (period_ms != 0 && period_ms != s_state.period_ms) {
+            s_state.period_ms = period_ms;
+            *changed = true;
+        }
+        if (*changed) {
+            s_state.generation++;
+        }
     }
+    *generation = s_state.generation;
+    state_write_end();
+    return ok;
 }
 
-void thermostat_init(void)
+void thermostat_restore_settings(const float thresholds[5], uint32_t period_ms, uint32_t generation)
+{
+    state_write_begin();
+    memcpy(s_state.thresholds, thresholds, sizeof(s_state.thresholds));
+    s_state.period_ms = period_ms;
+    s_state.generation = generation;
+    state_write_end();
+}
+
+/* Sample bus consumer driving the LEDs, only the newest of the samples waiting is shown */
+static void led_task(void *arg)
 {
-    if (settings_mutex == NULL) {
-        settings_mutex = xSemaphoreCreateMutex();
-        configASSERT(settings_mutex);
+    sample_bus_sub_t *sub = sample_bus_subscribe("leds");
+    sample_t sample;
+    while (sub != NULL) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bool got = false;
+        while (sample_bus_take(sub, &sample)) {
+            got = true;
+        }
+        if (got) {
+            thermostat_state_t state;
+            thermostat_state_read(&state);
+            update_leds(sample.temperature, state.thresholds);
+        }
     }
+    vTaskDelete(NULL);
+}
+
+void thermostat_init(void)
+{
+    tslog_init();   // first: it sets the clock everything is timestamped with
+    snapshot_init();
+    rollup_init();
+    history_init();
 
     for (int i = 0; i < 5; ++i) {
         gpio_reset_pin(led_gpios[i]);
         gpio_set_direction(led_gpios[i], GPIO_MODE_OUTPUT);
         gpio_set_level(led_gpios[i], 0);
     }
+    if (xTaskCreate(led_task, "leds", 2048, NULL, 4, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create led_task");
+    }
 
     // create task
     BaseType_t rc = xTaskCreate(thermostat_task, "thermo_task", 4096, NULL, 5, NULL);
@@ -76,9 +193,431 @@ void thermostat_init(void)
     }
 }
 
-void thermostat_task(void *pvParameters)
+typedef struct {
+    ds18b20_device_handle_t handle;
+    onewire_device_address_t address;
+    ds18b20_resolution_t resolution;
+    float temperature;      // last value read from the scratchpad
+    bool has_temperature;
+    bool has_alarm_window;  // alarm_th/alarm_tl are what TH/TL hold
+    int8_t alarm_th;
+    int8_t alarm_tl;
+    int64_t rate_ref_us;    // start of the current rate window, 0 if none
+    float rate_ref_temperature;
+    float rate;             // C/s, absolute
+} sensor_slot_t;
+
+static sensor_slot_t sensors[THERMOSTAT_MAX_SENSORS];
+static int sensor_count = 0;
+static ds18b20_resolution_t s_max_resolution = DS18B20_RESOLUTION_12B;  // finest one that fits in the sample period
+static bool s_search_pending = false;   // a probe answered that is not attached
+
+/* ROM codes known from NVS, checked directly instead of searching the bus */
+static sensor_cache_entry_t cached_sensors[THERMOSTAT_MAX_SENSORS];
+static int cached_count = -1; // not loaded yet
+
+static void drop_sensors(void)
+{
+    for (int i = 0; i < sensor_count; ++i) {
+        ds18b20_del_device(sensors[i].handle);
+        sensors[i].handle = NULL;
+    }
+    sensor_count = 0;
+}
+
+static int find_sensor(onewire_device_address_t address)
+{
+    for (int i = 0; i < sensor_count; ++i) {
+        if (sensors[i].address == address) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* With verify, the probe must answer a Read Scratchpad before anything is written to it */
+static bool add_sensor(onewire_device_t *dev, ds18b20_resolution_t resolution, bool verify)
+{
+    ds18b20_config_t cfg = {};
+    ds18b20_device_handle_t handle = NULL;
+    if (sensor_count >= THERMOSTAT_MAX_SENSORS || ds18b20_new_device(dev, &cfg, &handle) != ESP_OK) {
+        return false;
+    }
+    float temp;
+    if (verify && ds18b20_get_temperature(handle, &temp) != ESP_OK) {
+        ds18b20_del_device(handle);
+        return false;
+    }
+    if (resolution > s_max_resolution) {
+        resolution = s_max_resolution;
+    }
+    if (ds18b20_set_resolution(handle, resolution) != ESP_OK) {
+        resolution = DS18B20_RESOLUTION_12B; // power-on default
+    }
+    sensors[sensor_count++] = (sensor_slot_t) {
+        .handle = handle,
+        .address = dev->address,
+        .resolution = resolution,
+    };
+    return true;
+}
+
+/* A broadcast conversion takes as long as its finest probe */
+static ds18b20_resolution_t bus_resolution(void)
+{
+    ds18b20_resolution_t resolution = DS18B20_RESOLUTION_9B;
+    for (int i = 0; i < sensor_count; ++i) {
+        if (sensors[i].resolution > resolution) {
+            resolution = sensors[i].resolution;
+        }
+    }
+    return resolution;
+}
+
+/* After the sample period shrank: probes finer than the new limit are brought down before the next conversion */
+static void cap_resolutions(void)
+{
+    for (int i = 0; i < sensor_count; ++i) {
+        if (sensors[i].resolution > s_max_resolution &&
+                ds18b20_set_resolution(sensors[i].handle, s_max_resolution) == ESP_OK) {
+            sensors[i].resolution = s_max_resolution;
+        }
+    }
+}
+
+static void save_sensor_cache(void)
+{
+    for (int i = 0; i < sensor_count; ++i) {
+        cached_sensors[i] = (sensor_cache_entry_t) {
+            .address = sensors[i].address,
+            .resolution = sensors[i].resolution,
+        };
+    }
+    cached_count = sensor_count;
+    sensor_cache_save(cached_sensors, cached_count);
+}
+
+/* Match ROM + Read Scratchpad every cached sensor, true only if all of them answer */
+static bool attach_cached_sensors(onewire_bus_handle_t bus)
+{
+    if (cached_count < 0) {
+        cached_count = sensor_cache_load(cached_sensors, THERMOSTAT_MAX_SENSORS);
+    }
+    if (cached_count == 0) {
+        return false;
+    }
+
+    for (int i = 0; i < cached_count; ++i) {
+        onewire_device_t dev = { .bus = bus, .address = cached_sensors[i].address };
+        if (!add_sensor(&dev, (ds18b20_resolution_t)cached_sensors[i].resolution, true)) {
+            ESP_LOGW(TAG, "Cached DS18B20 %016llX is missing", dev.address);
+            drop_sensors();
+            return false;
+        }
+    }
+    ESP_LOGI(TAG, "%d cached DS18B20 attached without search", sensor_count);
+    return true;
+}
+
+/* ROM search, probes that are attached already are left alone. Returns the number of new ones */
+static int discover_sensors(onewire_bus_handle_t bus)
+{
+    onewire_device_iter_handle_t iter = NULL;
+    onewire_device_t dev;
+    if (onewire_new_device_iter(bus, &iter) != ESP_OK) {
+        return 0;
+    }
+    // Only walk the temperature sensors, other devices on the bus are skipped by the search itself
+    onewire_device_iter_set_family(iter, DS18B20_FAMILY_CODE);
+    int added = 0;
+    while (sensor_count < THERMOSTAT_MAX_SENSORS && onewire_device_iter_get_next(iter, &dev) == ESP_OK) {
+        if (find_sensor(dev.address) < 0 && add_sensor(&dev, DS18B20_RESOLUTION_12B, false)) {
+            ESP_LOGI(TAG, "DS18B20 #%d found and configured, address: %016llX", sensor_count, dev.address);
+            added++;
+        }
+    }
+    onewire_del_device_iter(iter);
+    if (added == 0) {
+        return 0;
+    }
+
+    // One broadcast conversion tells how long the slowest probe takes, without converting them one after another
+    ds18b20_conversion_t conversion = { .wait_mode = DS18B20_WAIT_MODE_POLL };
+    if (ds18b20_start_temperature_conversion_for_all(bus, bus_resolution(), &conversion) == ESP_OK &&
+            ds18b20_finish_temperature_conversion(&conversion) == ESP_OK && conversion.elapsed_us > 0) {
+        ESP_LOGI(TAG, "%d DS18B20 convert in %lld ms", sensor_count, conversion.elapsed_us / 1000);
+    }
+    save_sensor_cache();
+    return added;
+}
+
+static int8_t clamp_alarm(float value)
+{
+    if (value < DS18B20_ALARM_MIN) {
+        return DS18B20_ALARM_MIN;
+    }
+    if (value > DS18B20_ALARM_MAX) {
+        return DS18B20_ALARM_MAX;
+    }
+    return (int8_t)value;
+}
+
+/*
+ * Load every probe's TH/TL so that its alarm flag is set before the mean of the probes may leave its LED band.
+ * The mean stays in the band as long as no probe moves further from its last reading than the mean is from
+ * the band edges, so every probe gets that window around its own reading.
+ * The sensor compares whole degrees (alarm when T >= TH or T <= TL), so the window is rounded inwards
+ * and a probe may answer the alarm search a little early, never late. Only windows that change are written.
+ */
+static void push_alarm_windows(float mean, const float thresholds[5])
+{
+    int band = temperature_band(mean, thresholds);
+    float below = band >= 0 ? mean - thresholds[band] : INFINITY;
+    float above = band < 4 ? thresholds[band + 1] - mean : INFINITY;
+    for (int i = 0; i < sensor_count; ++i) {
+        sensor_slot_t *slot = &sensors[i];
+        if (!slot->has_temperature) {
+            continue;
+        }
+        int8_t tl = isinf(below) ? DS18B20_ALARM_MIN : clamp_alarm(ceilf(slot->temperature - below) - 1.0f);
+        int8_t th = isinf(above) ? DS18B20_ALARM_MAX : clamp_alarm(floorf(slot->temperature + above));
+        if (slot->has_alarm_window && slot->alarm_th == th && slot->alarm_tl == tl) {
+            continue;
+        }
+        if (ds18b20_set_alarm_thresholds(slot->handle, th, tl) == ESP_OK) {
+            slot->has_alarm_window = true;
+            slot->alarm_th = th;
+            slot->alarm_tl = tl;
+            ESP_LOGD(TAG, "Sensor #%d: alarm window %d..%d C loaded", i + 1, tl, th);
+        } else {
+            slot->has_alarm_window = false;
+        }
+    }
+}
+
+static ds18b20_resolution_t resolution_for(float distance, float rate)
+{
+    if (rate >= RESOLUTION_FAST_RATE || distance < 0.5f) {
+        return DS18B20_RESOLUTION_12B;
+    }
+    if (distance < 1.0f) {
+        return DS18B20_RESOLUTION_11B;
+    }
+    if (distance < 2.0f) {
+        return DS18B20_RESOLUTION_10B;
+    }
+    return DS18B20_RESOLUTION_9B;
+}
+
+/*
+ * Rate of change over windows of RESOLUTION_RATE_WINDOW_US.
+ * One LSB of the current resolution is not counted, a 9-bit reading flickering by 0.5 C is not a trend.
+ */
+static void update_rate(sensor_slot_t *slot, float temp)
+{
+    int64_t now = esp_timer_get_time();
+    if (slot->rate_ref_us == 0) {
+        slot->rate_ref_us = now;
+        slot->rate_ref_temperature = temp;
+        return;
+    }
+    int64_t window = now - slot->rate_ref_us;
+    if (window < RESOLUTION_RATE_WINDOW_US) {
+        return;
+    }
+    float lsb = 0.5f / (1 << slot->resolution);
+    float change = fabsf(temp - slot->rate_ref_temperature) - lsb;
+    slot->rate = change > 0.0f ? change * 1e6f / window : 0.0f;
+    slot->rate_ref_us = now;
+    slot->rate_ref_temperature = temp;
+}
+
+/* Pick the resolution for the next conversion, the scratchpad is only written when it changes */
+static void apply_resolution_policy(int index, const float thresholds[5])
+{
+    sensor_slot_t *slot = &sensors[index];
+    float distance = INFINITY;
+    for (int i = 0; i < 5; ++i) {
+        distance = fminf(distance, fabsf(slot->temperature - thresholds[i]));
+    }
+    ds18b20_resolution_t target = resolution_for(distance, slot->rate);
+    if (target < slot->resolution) {
+        // only go coarser once clearly past the band edge, a higher resolution is taken at once
+        ds18b20_resolution_t lower = resolution_for(distance - RESOLUTION_HYSTERESIS, slot->rate);
+        target = lower < slot->resolution ? lower : slot->resolution;
+    }
+    if (target > s_max_resolution) {
+        target = s_max_resolution; // the conversion has to fit in the sample period
+    }
+    if (target == slot->resolution) {
+        return;
+    }
+    if (ds18b20_set_resolution(slot->handle, target) == ESP_OK) {
+        ESP_LOGI(TAG, "Sensor #%d: %d-bit (%.2f C from threshold, %.3f C/s)",
+                 index + 1, 9 + target, distance, slot->rate);
+        slot->resolution = target;
+    }
+}
+
+static bool read_sensor(int index, const float thresholds[5])
+{
+    sensor_slot_t *slot = &sensors[index];
+    float temp = 0.0f;
+    if (ds18b20_get_temperature(slot->handle, &temp) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to read sensor #%d", index + 1);
+        return false;
+    }
+    ESP_LOGI(TAG, "Sensor #%d: %.2f C", index + 1, temp);
+    slot->temperature = temp;
+    slot->has_temperature = true;
+    update_rate(slot, temp);
+    apply_resolution_policy(index, thresholds);
+    return true;
+}
+
+/*
+ * Monitoring mode: only the probes whose alarm flag was set by the last conversion answer the alarm search,
+ * the others are still inside their window and keep their previous value.
+ * Returns false if the search itself failed, the caller then falls back to a full read.
+ */
+static bool read_alarmed_sensors(onewire_bus_handle_t bus, const float thresholds[5], bool *failed)
+{
+    onewire_device_iter_handle_t iter = NULL;
+    onewire_device_t dev;
+    if (onewire_new_device_iter(bus, &iter) != ESP_OK) {
+        return false;
+    }
+    onewire_device_iter_set_family(iter, DS18B20_FAMILY_CODE);
+    onewire_device_iter_set_alarm_search(iter, true);
+
+    bool ok = true;
+    int alarmed = 0;
+    esp_err_t err;
+    while ((err = onewire_device_iter_get_next(iter, &dev)) == ESP_OK) {
+        int index = find_sensor(dev.address);
+        if (index < 0) {
+            // a probe that was added while the others kept answering: the next cycle searches for it
+            ESP_LOGI(TAG, "Unknown DS18B20 %016llX in alarm state", dev.address);
+            s_search_pending = true;
+            continue;
+        }
+        alarmed++;
+        if (!read_sensor(index, thresholds)) {
+            *failed = true;
+        }
+    }
+    if (err != ESP_ERR_NOT_FOUND) {
+        ok = false;
+    }
+    onewire_del_device_iter(iter);
+    ESP_LOGD(TAG, "%d sensor(s) in alarm state", alarmed);
+    return ok;
+}
+
+/* Sampling cadence: wake-ups are aimed at absolute times with a one-shot esp_timer, so delays never add up */
+static esp_timer_handle_t s_wake_timer = NULL;
+static TaskHandle_t s_task = NULL;
+
+/* Distance of the published samples from their slots, summed up over THERMOSTAT_CADENCE_REPORT samples */
+static struct {
+    uint32_t samples;
+    uint32_t missed;        // slots skipped because a cycle overran
+    int64_t sum_abs_us;
+    int64_t max_abs_us;
+} s_cadence;
+
+static void wake_timer_cb(void *arg)
+{
+    xTaskNotifyGive(s_task);
+}
+
+/* Returns once esp_timer_get_time() has reached t_us, at once if it already has */
+static void sleep_until(int64_t t_us)
+{
+    int64_t now = esp_timer_get_time();
+    if (t_us <= now) {
+        return;
+    }
+    if (esp_timer_start_once(s_wake_timer, t_us - now) != ESP_OK) {
+        vTaskDelay(pdMS_TO_TICKS((t_us - now) / 1000) + 1);
+        return;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+/* Sample bus subscribers that fell behind, logged with the cadence whenever the total has grown */
+static void report_bus_overruns(void)
+{
+    static uint32_t s_reported = 0;
+    char line[96] = "";
+    size_t len = 0;
+    uint32_t total = 0;
+    const char *name;
+    uint32_t overruns;
+    for (unsigned i = 0; sample_bus_overruns(i, &name, &overruns); ++i) {
+        total += overruns;
+        if (overruns > 0 && len < sizeof(line)) {
+            len += snprintf(line + len, sizeof(line) - len, " %s %lu", name, (unsigned long)overruns);
+        }
+    }
+    if (total != s_reported) {
+        ESP_LOGW(TAG, "Samples missed on the sample bus so far:%s", line);
+        s_reported = total;
+    }
+}
+
+/* Measured conversion times per probe since it was attached, what sample periods can be tuned from */
+static void report_conversion_times(void)
+{
+    char line[160] = "";
+    size_t len = 0;
+    for (int i = 0; i < sensor_count && len < sizeof(line); ++i) {
+        ds18b20_conversion_stats_t stats;
+        if (ds18b20_get_conversion_stats(sensors[i].handle, &stats) == ESP_OK && stats.count > 0) {
+            len += snprintf(line + len, sizeof(line) - len, " #%d %lu/%lu/%lu", i + 1,
+                            (unsigned long)(stats.min_us / 1000), (unsigned long)(stats.total_us / stats.count / 1000),
+                            (unsigned long)(stats.max_us / 1000));
+        }
+    }
+    if (len > 0) {
+        ESP_LOGI(TAG, "Conversion min/mean/max ms:%s", line);
+    }
+}
+
+static void record_jitter(int64_t jitter_us, uint32_t period_ms)
+{
+    int64_t abs_us = jitter_us < 0 ? -jitter_us : jitter_us;
+    ESP_LOGD(TAG, "Sample %lld us off its slot", jitter_us);
+    s_cadence.samples++;
+    s_cadence.sum_abs_us += abs_us;
+    if (abs_us > s_cadence.max_abs_us) {
+        s_cadence.max_abs_us = abs_us;
+    }
+    if (s_cadence.samples >= THERMOSTAT_CADENCE_REPORT) {
+        ESP_LOGI(TAG, "Cadence %lu ms: jitter mean %lld us, max %lld us, %lu slot(s) missed",
+                 (unsigned long)period_ms, s_cadence.sum_abs_us / s_cadence.samples, s_cadence.max_abs_us,
+                 (unsigned long)s_cadence.missed);
+        memset(&s_cadence, 0, sizeof(s_cadence));
+        report_bus_overruns();
+        report_conversion_times();
+    }
+}
+
+/* Finest resolution whose conversion and the reads after it fit in one period */
+static ds18b20_resolution_t resolution_limit(uint32_t period_ms)
+{
+    ds18b20_resolution_t resolution = DS18B20_RESOLUTION_12B;
+    while (resolution > DS18B20_RESOLUTION_9B &&
+            ds18b20_get_conversion_time_ms(resolution) + THERMOSTAT_BUS_MARGIN_MS > period_ms) {
+        resolution = (ds18b20_resolution_t)(resolution - 1);
+    }
+    return resolution;
+}
+
+static onewire_bus_handle_t new_board_bus(void)
 {
     onewire_bus_handle_t bus = NULL;
+#if CONFIG_SOC_RMT_SUPPORTED
     onewire_bus_config_t bus_config = {
         .bus_gpio_num = ONEWIRE_BUS_GPIO,
         .flags = { .en_pull_up = true }
@@ -90,65 +629,155 @@ void thermostat_task(void *pvParameters)
         ESP_LOGE(TAG, "onewire_new_bus_rmt failed: %s", esp_err_to_name(err));
         vTaskDelay(pdMS_TO_TICKS(2000));
     }
+#else
+    ESP_LOGE(TAG, "No 1-Wire bus on this target, pass one to thermostat_task");
+#endif
+    return bus;
+}
 
-    ds18b20_device_handle_t sensor = NULL;
-    bool sensor_present = false;
+void thermostat_task(void *pvParameters)
+{
+    onewire_bus_handle_t bus = pvParameters ? (onewire_bus_handle_t)pvParameters : new_board_bus();
+
+    s_task = xTaskGetCurrentTaskHandle();
+    esp_timer_create_args_t timer_args = {
+        .callback = wake_timer_cb,
+        .name = "thermo_wake",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_wake_timer));
+
+    // Completion is detected on the bus, so nothing else may use it between start and finish
+    ds18b20_conversion_t conversion = { .wait_mode = DS18B20_WAIT_MODE_POLL };
+    // Settings of the last full read, and conversions since then
+    float thresholds[5] = {};
+    float pushed_thresholds[5] = {};
+    uint32_t pushed_period_ms = 0;
+    int since_full_read = 0;
+    int since_search = THERMOSTAT_SEARCH_INTERVAL;  // first search right after the first sample
+    int64_t slot_us = 0;    // when the next sample is due, 0 until the cadence is anchored
 
     while (1) {
-        if (!sensor_present) {
-            ESP_LOGI(TAG, "Searching for DS18B20...");
-            onewire_device_iter_handle_t iter = NULL;
-            onewire_device_t dev;
-            if (onewire_new_device_iter(bus, &iter) == ESP_OK) {
-                while (onewire_device_iter_get_next(iter, &dev) == ESP_OK) {
-                    ds18b20_config_t cfg = {};
-                    if (ds18b20_new_device(&dev, &cfg, &sensor) == ESP_OK) {
-                        sensor_present = true;
-                        ds18b20_set_resolution(sensor, DS18B20_RESOLUTION_12B);
-                        ESP_LOGI(TAG, "DS18B20 found and configured");
-                        break;
-                    }
+        thermostat_state_t state;
+        thermostat_state_read(&state);
+        s_max_resolution = resolution_limit(state.period_ms); // before any probe is configured below
+        cap_resolutions();  // and before the lead of the conversion is taken from them
+
+        if (sensor_count == 0) {
+            if (!attach_cached_sensors(bus)) {
+                // A cached sensor is gone (or nothing is cached yet): fall back to a full ROM search
+                ESP_LOGI(TAG, "Searching for DS18B20...");
+                discover_sensors(bus);
+                since_search = 0;
+                if (sensor_count == 0) {
+                    ESP_LOGW(TAG, "No DS18B20 found, retrying in 2s");
+                    vTaskDelay(pdMS_TO_TICKS(2000));
+                    continue;
                 }
             }
-            onewire_del_device_iter(iter);
-            if (!sensor_present) {
-                ESP_LOGW(TAG, "No DS18B20 found, retrying in 2s");
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                continue;
-            }
+            // New handles have no reading and no alarm window yet, and the cadence starts over
+            since_full_read = 0;
+            slot_us = 0;
         }
 
-        // Trigger conversion
-        if (sensor_present) {
-            if (ds18b20_trigger_temperature_conversion(sensor) != ESP_OK) {
-                ESP_LOGW(TAG, "trigger conversion failed, will retry sensor discovery");
-                ds18b20_del_device(sensor);
-                sensor = NULL;
-                sensor_present = false;
-                vTaskDelay(pdMS_TO_TICKS(1000));
-                continue;
+        memcpy(thresholds, state.thresholds, sizeof(thresholds));
+        int64_t period_us = (int64_t)state.period_ms * 1000;
+        bool full_read = since_full_read == 0 || memcmp(thresholds, pushed_thresholds, sizeof(thresholds)) != 0 ||
+                         state.period_ms != pushed_period_ms;
+        if (full_read) {
+            // New settings: every probe gets its alarm window written again, and may have to drop to a coarser resolution
+            memcpy(pushed_thresholds, thresholds, sizeof(thresholds));
+            pushed_period_ms = state.period_ms;
+            for (int i = 0; i < sensor_count; ++i) {
+                sensors[i].has_alarm_window = false;
             }
+        }
+
+        // The conversion starts one conversion time ahead of the slot, the reading is ready when the slot comes
+        int64_t lead_us = (int64_t)ds18b20_get_conversion_time_ms(bus_resolution()) * 1000;
+        int64_t now = esp_timer_get_time();
+        if (slot_us == 0) {
+            slot_us = now + lead_us;
+        } else if (slot_us - lead_us < now) {
+            // the last cycle overran: the slots it ate into are skipped, the cadence keeps its phase
+            int64_t missed = (now - (slot_us - lead_us) + period_us - 1) / period_us;
+            slot_us += missed * period_us;
+            s_cadence.missed += missed;
+        }
+        sleep_until(slot_us - lead_us);
 
-            vTaskDelay(pdMS_TO_TICKS(750)); // wait conversion (12-bit worst-case ~750ms)
+        // One Skip ROM + Convert T for every sensor, each at its own resolution
+        if (ds18b20_start_temperature_conversion_for_all(bus, bus_resolution(), &conversion) != ESP_OK) {
+            ESP_LOGW(TAG, "trigger conversion failed, will retry sensor discovery");
+            drop_sensors();
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+        // Returns as soon as the slowest probe releases the bus
+        if (ds18b20_finish_temperature_conversion(&conversion) != ESP_OK) {
+            ESP_LOGW(TAG, "conversion status read failed");
+        }
+        if (conversion.elapsed_us > 0) {
+            ESP_LOGD(TAG, "Conversion took %lld ms", conversion.elapsed_us / 1000);
+        }
 
-            float temp = 0.0f;
-            if (ds18b20_get_temperature(sensor, &temp) == ESP_OK) {
-                if (xSemaphoreTake(settings_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                    current_temperature = temp;
-                    xSemaphoreGive(settings_mutex);
-                } else {
-                    current_temperature = temp; // best-effort
+        bool failed = false;
+        if (!full_read && !read_alarmed_sensors(bus, thresholds, &failed)) {
+            ESP_LOGW(TAG, "alarm search failed, reading all sensors");
+            full_read = true;
+        }
+        if (full_read) {
+            // Read every scratchpad with Match ROM
+            for (int i = 0; i < sensor_count; ++i) {
+                if (!read_sensor(i, thresholds)) {
+                    failed = true;
                 }
-                ESP_LOGI(TAG, "Temperature: %.2f C", temp);
-                update_leds(temp);
-            } else {
-                ESP_LOGW(TAG, "Failed to read temperature, dropping sensor handle");
-                ds18b20_del_device(sensor);
-                sensor = NULL;
-                sensor_present = false;
+            }
+            since_full_read = 0;
+        }
+        if (++since_full_read >= THERMOSTAT_FULL_READ_INTERVAL) {
+            since_full_read = 0;
+        }
+
+        // The room temperature is the mean of all probes, quiet ones keep their last reading
+        float sum = 0.0f;
+        int valid = 0;
+        for (int i = 0; i < sensor_count; ++i) {
+            if (sensors[i].has_temperature) {
+                sum += sensors[i].temperature;
+                valid++;
             }
         }
 
-        vTaskDelay(pdMS_TO_TICKS(200));
+        if (failed) {
+            ESP_LOGW(TAG, "Dropping sensor handles, will retry sensor discovery");
+            drop_sensors();
+        } else if (valid > 0) {
+            push_alarm_windows(sum / valid, thresholds);
+        }
+
+        if (valid > 0) {
+            float temp = sum / valid;
+            // a reading that is ready early waits for its slot, so samples are evenly spaced
+            sleep_until(slot_us);
+            record_jitter(esp_timer_get_time() - slot_us, state.period_ms);
+            // LEDs, web clients and the logs all take it from the bus on their own tasks
+            sample_t sample = {
+                .seq = thermostat_publish_sample(temp),
+                .t_ms = history_now_ms(),
+                .temperature = temp,
+            };
+            sample_bus_publish(&sample);
+            ESP_LOGI(TAG, "Temperature: %.2f C (%d/%d sensors)", temp, valid, sensor_count);
+        }
+
+        // A probe added while the attached ones keep answering only shows up in a search
+        if (sensor_count > 0 && (s_search_pending || ++since_search >= THERMOSTAT_SEARCH_INTERVAL)) {
+            s_search_pending = false;
+            since_search = 0;
+            if (discover_sensors(bus) > 0) {
+                since_full_read = 0;    // the new probes need a reading and an alarm window
+            }
+        }
+        slot_us += period_us;
     }
 }
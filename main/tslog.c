@@ -0,0 +1,427 @@
+#include "tslog.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "sample_bus.h"
+
+static const char *TAG = "TSLOG";
+
+/*
+ * The partition is a ring of blocks, one erase sector each, block n lives in sector n % s_block_count.
+ * A block is a header followed by the same 4 byte records as the RAM history, gap records included.
+ * No byte is programmed twice: the first half of the header when the block is opened, the records a whole
+ * flash page at a time once the page is full, the second half of the header when the block is full (sealed).
+ */
+#define TSLOG_BLOCK_SIZE 4096
+#define TSLOG_PAGE_SIZE 256
+#define TSLOG_MAGIC 0x474f4c54              // "TLOG"
+#define TSLOG_DT_UNIT_MS 10
+#define TSLOG_DT_MAX (UINT16_MAX - 1)       // an all-ones record is unprogrammed flash
+#define TSLOG_GAP INT16_MIN
+
+typedef struct {
+    // programmed when the block is opened
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t t_first_ms;
+    // programmed when the block is sealed, all ones until then
+    uint64_t t_last_ms;
+    uint16_t count;         // records, gaps included
+    uint16_t samples;       // records that are not gaps
+    uint32_t crc;           // crc32 of the header before it and of the records
+} tslog_header_t;
+
+typedef struct {
+    int16_t temp_x16;
+    uint16_t dt;
+} tslog_record_t;
+
+#define TSLOG_OPEN_SIZE offsetof(tslog_header_t, t_last_ms)
+#define TSLOG_RECORDS ((TSLOG_BLOCK_SIZE - sizeof(tslog_header_t)) / sizeof(tslog_record_t))
+
+typedef struct {
+    tslog_header_t header;
+    tslog_record_t records[TSLOG_RECORDS];
+} tslog_block_t;
+
+_Static_assert(sizeof(tslog_block_t) == TSLOG_BLOCK_SIZE, "a block must fill its sector");
+
+
+static const esp_partition_t *s_partition = NULL;
+static uint32_t s_block_count = 0;
+static uint32_t s_oldest_seq = 0;   // blocks s_oldest_seq .. s_end_seq - 1 are in the log
+static uint32_t s_end_seq = 0;
+static bool s_open_valid = false;   // s_end_seq - 1 is still being filled
+static tslog_block_t s_open;        // RAM image of that block
+static uint32_t s_open_records = 0;
+static uint32_t s_programmed = 0;   // bytes of s_open already in flash
+static uint64_t s_newest_ms = 0;    // time of the newest record
+static tslog_block_t s_read_buf;    // the sealed block readers looked at last
+static uint32_t s_read_seq = UINT32_MAX;
+static uint64_t s_clock_base_ms = 0;
+static SemaphoreHandle_t s_mutex = NULL;
+
+static size_t block_offset(uint32_t seq)
+{
+    return (size_t)(seq % s_block_count) * TSLOG_BLOCK_SIZE;
+}
+
+static bool header_sealed(const tslog_header_t *header)
+{
+    return header->count != UINT16_MAX;
+}
+
+static uint32_t block_crc(const tslog_block_t *block, uint32_t count)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&block->header, offsetof(tslog_header_t, crc));
+    return esp_rom_crc32_le(crc, (const uint8_t *)block->records, count * sizeof(tslog_record_t));
+}
+
+static bool read_header(uint32_t seq, tslog_header_t *header)
+{
+    if (s_open_valid && seq == s_end_seq - 1) {
+        *header = s_open.header;
+        return true;
+    }
+    if (esp_partition_read(s_partition, block_offset(seq), header, sizeof(*header)) != ESP_OK) {
+        return false;
+    }
+    return header->magic == TSLOG_MAGIC && header->seq == seq;
+}
+
+/* The open block comes from RAM, a sealed one is read and checked once and then kept until another is needed */
+static const tslog_block_t *load_block(uint32_t seq, uint32_t *count)
+{
+    if (s_open_valid && seq == s_end_seq - 1) {
+        *count = s_open_records;
+        return &s_open;
+    }
+    if (seq != s_read_seq) {
+        s_read_seq = UINT32_MAX;
+        if (esp_partition_read(s_partition, block_offset(seq), &s_read_buf, sizeof(s_read_buf)) != ESP_OK) {
+            return NULL;
+        }
+        const tslog_header_t *header = &s_read_buf.header;
+        if (header->magic != TSLOG_MAGIC || header->seq != seq || !header_sealed(header) ||
+                header->count > TSLOG_RECORDS || header->crc != block_crc(&s_read_buf, header->count)) {
+            ESP_LOGW(TAG, "block %lu is corrupt, skipped", (unsigned long)seq);
+            return NULL;
+        }
+        s_read_seq = seq;
+    }
+    *count = s_read_buf.header.count;
+    return &s_read_buf;
+}
+
+/* Programs every page of the open block that is complete now */
+static void program_pages(void)
+{
+    uint32_t used = sizeof(tslog_header_t) + s_open_records * sizeof(tslog_record_t);
+    uint32_t end = used - used % TSLOG_PAGE_SIZE;
+    if (end <= s_programmed) {
+        return;
+    }
+    esp_err_t err = esp_partition_write(s_partition, block_offset(s_open.header.seq) + s_programmed,
+                                        (const uint8_t *)&s_open + s_programmed, end - s_programmed);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "page write failed: %s", esp_err_to_name(err));
+    }
+    s_programmed = end;
+}
+
+static void seal_block(void)
+{
+    tslog_header_t *header = &s_open.header;
+    header->t_last_ms = s_newest_ms;
+    header->count = s_open_records;
+    header->samples = 0;
+    for (uint32_t i = 0; i < s_open_records; ++i) {
+        if (s_open.records[i].temp_x16 != TSLOG_GAP) {
+            header->samples++;
+        }
+    }
+    header->crc = block_crc(&s_open, s_open_records);
+    esp_err_t err = esp_partition_write(s_partition, block_offset(header->seq) + TSLOG_OPEN_SIZE,
+                                        (const uint8_t *)header + TSLOG_OPEN_SIZE, sizeof(*header) - TSLOG_OPEN_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "sealing block %lu failed: %s", (unsigned long)header->seq, esp_err_to_name(err));
+    }
+    s_open_valid = false;
+}
+
+static void open_block(uint64_t t_first_ms)
+{
+    uint32_t seq = s_end_seq;
+    if (seq - s_oldest_seq >= s_block_count) {
+        s_oldest_seq = seq - s_block_count + 1; // the oldest block is recycled
+    }
+    esp_err_t err = esp_partition_erase_range(s_partition, block_offset(seq), TSLOG_BLOCK_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "erasing block %lu failed: %s", (unsigned long)seq, esp_err_to_name(err));
+    }
+    memset(&s_open, 0xFF, sizeof(s_open));
+    s_open.header.magic = TSLOG_MAGIC;
+    s_open.header.seq = seq;
+    s_open.header.t_first_ms = t_first_ms;
+    err = esp_partition_write(s_partition, block_offset(seq), &s_open.header, TSLOG_OPEN_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "opening block %lu failed: %s", (unsigned long)seq, esp_err_to_name(err));
+    }
+    s_open_records = 0;
+    s_programmed = sizeof(tslog_header_t);
+    s_open_valid = true;
+    s_end_seq = seq + 1;
+}
+
+/* dt is in TSLOG_DT_UNIT_MS since the newest record, a full block is sealed and the record opens the next one */
+static void push_record(int16_t temp_x16, uint16_t dt)
+{
+    uint64_t t = s_newest_ms + (uint64_t)dt * TSLOG_DT_UNIT_MS;
+    if (s_open_valid && s_open_records == TSLOG_RECORDS) {
+        seal_block();
+    }
+    if (!s_open_valid) {
+        open_block(t);
+        dt = 0;
+    }
+    s_open.records[s_open_records++] = (tslog_record_t) {
+        .temp_x16 = temp_x16,
+        .dt = dt,
+    };
+    s_newest_ms = t;
+    program_pages();
+}
+
+static void write_sample(const sample_t *sample)
+{
+    float scaled = fminf(fmaxf(sample->temperature * 16.0f, TSLOG_GAP + 1), INT16_MAX);
+    int16_t temp_x16 = (int16_t)lroundf(scaled);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_end_seq == 0) {
+        s_newest_ms = sample->t_ms; // empty log, the first record starts it
+    }
+    uint64_t dt = sample->t_ms > s_newest_ms ? (sample->t_ms - s_newest_ms + TSLOG_DT_UNIT_MS / 2) / TSLOG_DT_UNIT_MS : 0;
+    while (dt > TSLOG_DT_MAX) {
+        push_record(TSLOG_GAP, TSLOG_DT_MAX);
+        dt -= TSLOG_DT_MAX;
+    }
+    push_record(temp_x16, dt);
+    xSemaphoreGive(s_mutex);
+}
+
+/* Sample bus consumer, a sector erase here only makes this ring fill up, the sensor loop never waits for it */
+static void tslog_task(void *arg)
+{
+    sample_bus_sub_t *sub = sample_bus_subscribe("tslog");
+    sample_t sample;
+    while (sub != NULL) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (sample_bus_take(sub, &sample)) {
+            write_sample(&sample);
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+/* Finds the newest block, then walks back over the blocks that still hold the sequence numbers before it */
+static void mount(void)
+{
+    tslog_header_t header;
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint32_t i = 0; i < s_block_count; ++i) {
+        if (esp_partition_read(s_partition, (size_t)i * TSLOG_BLOCK_SIZE, &header, sizeof(header)) == ESP_OK &&
+                header.magic == TSLOG_MAGIC && header.seq % s_block_count == i && (!found || header.seq > newest)) {
+            newest = header.seq;
+            found = true;
+        }
+    }
+    if (!found) {
+        ESP_LOGI(TAG, "empty log, %lu blocks of %u samples", (unsigned long)s_block_count, (unsigned)TSLOG_RECORDS);
+        return;
+    }
+    s_oldest_seq = newest;
+    while (s_oldest_seq > 0 && newest - s_oldest_seq + 1 < s_block_count && read_header(s_oldest_seq - 1, &header)) {
+        s_oldest_seq--;
+    }
+    s_end_seq = newest + 1;
+
+    // Records after a power loss end at the first unprogrammed one, the time of the newest is rebuilt from them
+    esp_partition_read(s_partition, block_offset(newest), &s_open, sizeof(s_open));
+    uint32_t count = 0;
+    s_newest_ms = s_open.header.t_first_ms;
+    while (count < TSLOG_RECORDS && (s_open.records[count].temp_x16 != -1 || s_open.records[count].dt != UINT16_MAX)) {
+        s_newest_ms += (uint64_t)s_open.records[count].dt * TSLOG_DT_UNIT_MS;
+        count++;
+    }
+    if (!header_sealed(&s_open.header)) {
+        // carry on filling it, the rest of a half written page is still erased
+        s_open_records = count;
+        s_programmed = sizeof(tslog_header_t) + count * sizeof(tslog_record_t);
+        s_open_valid = true;
+    }
+    ESP_LOGI(TAG, "blocks %lu..%lu, newest sample at %llu ms", (unsigned long)s_oldest_seq, (unsigned long)newest,
+             (unsigned long long)s_newest_ms);
+}
+
+void tslog_init(void)
+{
+    if (s_mutex != NULL) {
+        return;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    configASSERT(s_mutex);
+
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, TSLOG_PARTITION_LABEL);
+    if (s_partition == NULL) {
+        ESP_LOGW(TAG, "no \"%s\" partition, samples are not logged", TSLOG_PARTITION_LABEL);
+        return;
+    }
+    s_block_count = s_partition->size / TSLOG_BLOCK_SIZE;
+    mount();
+    if (s_end_seq > 0) {
+        s_clock_base_ms = s_newest_ms + 1;
+    }
+
+    // the slowest consumer, below the LEDs, the web layer and the history
+    if (xTaskCreate(tslog_task, "tslog", 3072, NULL, 2, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create tslog task");
+    }
+}
+
+uint64_t tslog_now_ms(void)
+{
+    return s_clock_base_ms + (uint64_t)(esp_timer_get_time() / 1000);
+}
+
+/* Last block that starts at or before from_ms, the oldest one if none does */
+static uint32_t find_block(uint64_t from_ms)
+{
+    tslog_header_t header;
+    uint32_t lo = s_oldest_seq;
+    uint32_t hi = s_end_seq - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (read_header(mid, &header) && header.t_first_ms <= from_ms) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+void tslog_cursor_init(tslog_cursor_t *cursor, uint64_t from_ms)
+{
+    cursor->block = 0;
+    cursor->record = 0;
+    cursor->t_ms = 0;
+    if (s_partition == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_end_seq > 0) {
+        cursor->block = find_block(from_ms);
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+size_t tslog_count(uint64_t from_ms, uint64_t to_ms)
+{
+    size_t count = 0;
+    if (s_partition == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (uint32_t seq = s_end_seq > 0 ? find_block(from_ms) : 0; seq < s_end_seq; ++seq) {
+        tslog_header_t header;
+        if (!read_header(seq, &header)) {
+            continue;
+        }
+        if (header.t_first_ms > to_ms) {
+            break;
+        }
+        bool open = s_open_valid && seq == s_end_seq - 1;
+        if (!open && header_sealed(&header) && header.t_first_ms >= from_ms && header.t_last_ms <= to_ms) {
+            count += header.samples; // the whole block is in range, the header knows
+            continue;
+        }
+        uint32_t records;
+        const tslog_block_t *block = load_block(seq, &records);
+        if (block == NULL) {
+            continue;
+        }
+        uint64_t t = block->header.t_first_ms;
+        for (uint32_t i = 0; i < records; ++i) {
+            t += (uint64_t)block->records[i].dt * TSLOG_DT_UNIT_MS;
+            if (t > to_ms) {
+                break;
+            }
+            if (t >= from_ms && block->records[i].temp_x16 != TSLOG_GAP) {
+                count++;
+            }
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    return count;
+}
+
+size_t tslog_read(tslog_cursor_t *cursor, uint64_t from_ms, uint64_t to_ms, history_sample_t *out, size_t max)
+{
+    size_t n = 0;
+    if (s_partition == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    while (n < max && cursor->block < s_end_seq) {
+        if (cursor->block < s_oldest_seq) {
+            // the writer recycled this block, carry on from the oldest one
+            cursor->block = s_oldest_seq;
+            cursor->record = 0;
+        }
+        uint32_t records;
+        const tslog_block_t *block = load_block(cursor->block, &records);
+        if (block == NULL) {
+            cursor->block++;
+            cursor->record = 0;
+            continue;
+        }
+        if (cursor->record == 0) {
+            cursor->t_ms = block->header.t_first_ms;
+        }
+        bool past_end = false;
+        while (n < max && cursor->record < records) {
+            const tslog_record_t *rec = &block->records[cursor->record];
+            uint64_t t = cursor->t_ms + (uint64_t)rec->dt * TSLOG_DT_UNIT_MS;
+            if (t > to_ms) {
+                past_end = true;
+                break;
+            }
+            if (t >= from_ms && rec->temp_x16 != TSLOG_GAP) {
+                out[n++] = (history_sample_t) {
+                    .t_ms = t,
+                    .temp = rec->temp_x16 / 16.0f,
+                };
+            }
+            cursor->record++;
+            cursor->t_ms = t;
+        }
+        if (past_end || cursor->record < records || block == &s_open) {
+            break;
+        }
+        cursor->block++;
+        cursor->record = 0;
+    }
+    xSemaphoreGive(s_mutex);
+    return n;
+}
@@ -1,20 +1,60 @@
 #include "webserver.h"
 #include "thermostat.h"
+#include "snapshot.h"
+#include "asset_etags.h"
+#include "settings_parser.h"
+#include "history.h"
+#include "binfmt.h"
+#include "tslog.h"
+#include "rollup.h"
+#include "lttb.h"
+#include "settings_store.h"
+#include "sample_bus.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <math.h>
 
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_http_server.h"
-#include "cJSON.h"
+#include "esp_random.h"
 #include "freertos/semphr.h"
-#include "nvs_flash.h"
-#include "nvs.h"
+#include "freertos/task.h"
 
 static const char *TAG = "WEB";
 
+#define WS_MAX_CLIENTS 8
+/* Long-poll: requests held at most this long, and at most this many at once so sockets stay free for the rest */
+#define LONGPOLL_TIMEOUT_MS 25000
+#define LONGPOLL_MAX_PARKED 4
+/* /api/history: points per response unless ?max= asks for fewer */
+#define HISTORY_DEFAULT_POINTS 500
+/* POST bodies: receive timeouts in a row (recv_wait_timeout each) before a stalled client gets 408 */
+#define RECV_MAX_TIMEOUTS 3
+
+static httpd_handle_t s_server = NULL;
+static atomic_bool s_push_pending = false;
+/* Sequence number of the last sample pushed to every client */
+static uint32_t s_last_pushed_seq = 0;
+/* Part of every /api/data ETag, so a sequence number from before a reboot never matches */
+static uint32_t s_boot_id = 0;
+
+/* /api/data?after=<seq> requests waiting for a newer sample, taken out of the httpd task */
+typedef struct {
+    httpd_req_t *req;       // async copy, NULL if the slot is free
+    uint32_t after;
+    TickType_t deadline;
+    snapshot_format_t format;
+} parked_req_t;
+
+static parked_req_t s_parked[LONGPOLL_MAX_PARKED];
+static SemaphoreHandle_t s_parked_mutex = NULL;
+static TaskHandle_t s_longpoll_task = NULL;
+
 /* Symbols from EMBED_TXTFILES (CMake) */
 extern const uint8_t _binary_page_html_gz_start[];
 extern const uint8_t _binary_page_html_gz_end[];
@@ -25,36 +65,26 @@ extern const uint8_t _binary_style_css_gz_end[];
 extern const uint8_t _binary_script_js_gz_start[];
 extern const uint8_t _binary_script_js_gz_end[];
 
-// --- NVS helpers ---
-static void save_thresholds(void)
+// --- Web handlers ---
+/* True if the client's If-None-Match lists etag (or is "*") */
+static bool etag_matches(httpd_req_t *req, const char *etag)
 {
-    nvs_handle_t handle;
-    if (nvs_open("storage", NVS_READWRITE, &handle) != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to open NVS");
-        return;
+    char value[128];
+    size_t len = httpd_req_get_hdr_value_len(req, "If-None-Match");
+    if (len == 0 || len >= sizeof(value) ||
+            httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value)) != ESP_OK) {
+        return false;
     }
-    nvs_set_blob(handle, "thresholds", g_settings.thresholds, sizeof(g_settings.thresholds));
-    nvs_commit(handle);
-    nvs_close(handle);
+    return strcmp(value, "*") == 0 || strstr(value, etag) != NULL;
 }
 
-static void load_thresholds(void)
+static esp_err_t send_not_modified(httpd_req_t *req)
 {
-    nvs_handle_t handle;
-    if (nvs_open("storage", NVS_READONLY, &handle) != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to open NVS");
-        return;
-    }
-    size_t size = sizeof(g_settings.thresholds);
-    esp_err_t err = nvs_get_blob(handle, "thresholds", g_settings.thresholds, &size);
-    if (err != ESP_OK) {
-        ESP_LOGI(TAG, "No saved thresholds, using defaults");
-    }
-    nvs_close(handle);
+    httpd_resp_set_status(req, "304 Not Modified");
+    return httpd_resp_send(req, NULL, 0);
 }
 
-// --- Web handlers ---
-static esp_err_t send_gzip_asset(httpd_req_t *req, const uint8_t *start, const uint8_t *end, const char *content_type)
+static esp_err_t send_gzip_asset(httpd_req_t *req, const uint8_t *start, const uint8_t *end, const char *content_type, const char *etag)
 {
     size_t size = (size_t)(end - start);
     if (size == 0) {
@@ -62,106 +92,643 @@ static esp_err_t send_gzip_asset(httpd_req_t *req, const uint8_t *start, const u
         return ESP_FAIL;
     }
 
-    httpd_resp_set_type(req, content_type);
-    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-
-    if (strstr(content_type, "text/html") || strstr(content_type, "json")) {
-        httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
-        httpd_resp_set_hdr(req, "Pragma", "no-cache");
-        httpd_resp_set_hdr(req, "Expires", "0");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    if (strstr(content_type, "text/html")) {
+        // the page links the current css/js by hash, so it is revalidated every time
+        httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
     } else {
         httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=31536000");
     }
+    if (etag_matches(req, etag)) {
+        return send_not_modified(req);
+    }
 
+    httpd_resp_set_type(req, content_type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
     return httpd_resp_send(req, (const char *)start, size);
 }
 
 static esp_err_t root_handler(httpd_req_t* req) {
-    return send_gzip_asset(req, _binary_page_html_gz_start, _binary_page_html_gz_end, "text/html; charset=utf-8");
+    return send_gzip_asset(req, _binary_page_html_gz_start, _binary_page_html_gz_end, "text/html; charset=utf-8", ASSET_ETAG_PAGE);
+}
+
+/* The payload is rendered by snapshot_publish() once per sample, nothing is built or locked here */
+static esp_err_t send_snapshot(httpd_req_t *req, snapshot_format_t format)
+{
+    char buf[SNAPSHOT_MAX_LEN];
+    uint32_t seq;
+    size_t len = snapshot_read(format, buf, sizeof(buf), &seq);
+    if (len == 0) {
+        return httpd_resp_send_500(req);
+    }
+
+    // the sample's sequence number is its version, a poll that gets nothing new costs only headers
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%08lx-%lu%s\"", (unsigned long)s_boot_id, (unsigned long)seq,
+             format == SNAPSHOT_BINARY ? "b" : "");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "Vary", "Accept");
+    if (etag_matches(req, etag)) {
+        return send_not_modified(req);
+    }
+    httpd_resp_set_type(req, format == SNAPSHOT_BINARY ? BINFMT_CONTENT_TYPE : "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+static uint32_t current_seq(void)
+{
+    char buf[SNAPSHOT_MAX_LEN];
+    uint32_t seq = 0;
+    snapshot_read(SNAPSHOT_JSON, buf, sizeof(buf), &seq);
+    return seq;
+}
+
+/* JSON unless the client asks for the binary encoding */
+static bool accepts_binary(httpd_req_t *req)
+{
+    char accept[128];
+    if (httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept)) != ESP_OK) {
+        return false;
+    }
+    return strstr(accept, BINFMT_CONTENT_TYPE) != NULL;
+}
+
+/* Returns true if the request was handed over to the long-poll task */
+static bool park_request(httpd_req_t *req, uint32_t after, snapshot_format_t format)
+{
+    bool parked = false;
+    xSemaphoreTake(s_parked_mutex, portMAX_DELAY);
+    for (int i = 0; i < LONGPOLL_MAX_PARKED; ++i) {
+        if (s_parked[i].req == NULL) {
+            if (httpd_req_async_handler_begin(req, &s_parked[i].req) == ESP_OK) {
+                s_parked[i].after = after;
+                s_parked[i].format = format;
+                s_parked[i].deadline = xTaskGetTickCount() + pdMS_TO_TICKS(LONGPOLL_TIMEOUT_MS);
+                parked = true;
+            } else {
+                s_parked[i].req = NULL;
+            }
+            break;
+        }
+    }
+    xSemaphoreGive(s_parked_mutex);
+    if (parked) {
+        // the sample may have been published meanwhile, or this is the nearest deadline now
+        xTaskNotifyGive(s_longpoll_task);
+    }
+    return parked;
+}
+
+/* Answers parked requests once a newer sample is out or they time out, woken by webserver_notify_update() */
+static void longpoll_task(void *arg)
+{
+    while (1) {
+        parked_req_t ready[LONGPOLL_MAX_PARKED];
+        bool fresh[LONGPOLL_MAX_PARKED];
+        int ready_count = 0;
+        TickType_t wait = portMAX_DELAY;
+        TickType_t now = xTaskGetTickCount();
+        uint32_t seq = current_seq();
+
+        xSemaphoreTake(s_parked_mutex, portMAX_DELAY);
+        for (int i = 0; i < LONGPOLL_MAX_PARKED; ++i) {
+            if (s_parked[i].req == NULL) {
+                continue;
+            }
+            // sequence numbers only grow within a boot, any other value means there is something new to get
+            bool is_fresh = seq != s_parked[i].after;
+            TickType_t left = s_parked[i].deadline - now;
+            if (is_fresh || (int32_t)left <= 0) {
+                fresh[ready_count] = is_fresh;
+                ready[ready_count++] = s_parked[i];
+                s_parked[i].req = NULL;
+            } else if (left < wait) {
+                wait = left;
+            }
+        }
+        xSemaphoreGive(s_parked_mutex);
+
+        for (int i = 0; i < ready_count; ++i) {
+            httpd_req_t *req = ready[i].req;
+            if (fresh[i]) {
+                send_snapshot(req, ready[i].format);
+            } else {
+                httpd_resp_set_status(req, "204 No Content");
+                httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+                httpd_resp_send(req, NULL, 0);
+            }
+            httpd_req_async_handler_complete(req);
+        }
+        if (ready_count == 0) {
+            ulTaskNotifyTake(pdTRUE, wait);
+        }
+    }
+}
+
+static esp_err_t serve_data(httpd_req_t *req, snapshot_format_t format)
+{
+    char query[32];
+    char value[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+            httpd_query_key_value(query, "after", value, sizeof(value)) == ESP_OK) {
+        uint32_t after = strtoul(value, NULL, 10);
+        // hold the request until a newer sample is published, unless there already is one
+        if (s_longpoll_task && after == current_seq() && park_request(req, after, format)) {
+            return ESP_OK;
+        }
+    }
+    return send_snapshot(req, format);
 }
 
 static esp_err_t api_data_get_handler(httpd_req_t *req)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (!root) {
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+    return serve_data(req, accepts_binary(req) ? SNAPSHOT_BINARY : SNAPSHOT_JSON);
+}
+
+static esp_err_t api_data_bin_get_handler(httpd_req_t *req)
+{
+    return serve_data(req, SNAPSHOT_BINARY);
+}
+
+// --- History ---
+/* Small response buffer flushed with httpd_resp_send_chunk, the response is never built as a whole */
+typedef struct {
+    httpd_req_t *req;
+    char buf[512];
+    size_t len;
+    esp_err_t err;
+} chunk_writer_t;
+
+static void chunk_flush(chunk_writer_t *w)
+{
+    if (w->len && w->err == ESP_OK) {
+        w->err = httpd_resp_send_chunk(w->req, w->buf, w->len);
+    }
+    w->len = 0;
+}
+
+static void chunk_write(chunk_writer_t *w, const void *data, size_t len)
+{
+    if (w->len + len > sizeof(w->buf)) {
+        chunk_flush(w);
+    }
+    memcpy(w->buf + w->len, data, len); // callers only write a few bytes at a time
+    w->len += len;
+}
+
+static void chunk_printf(chunk_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void chunk_printf(chunk_writer_t *w, const char *fmt, ...)
+{
+    va_list args;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        va_start(args, fmt);
+        int n = vsnprintf(w->buf + w->len, sizeof(w->buf) - w->len, fmt, args);
+        va_end(args);
+        if (n >= 0 && (size_t)n < sizeof(w->buf) - w->len) {
+            w->len += n;
+            return;
+        }
+        chunk_flush(w); // did not fit, retry in an empty buffer
+    }
+}
+
+static uint64_t query_u64(const char *query, const char *key, uint64_t fallback)
+{
+    char value[24];
+    if (httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) {
+        return fallback;
+    }
+    return strtoull(value, NULL, 10);
+}
+
+/* Streams the samples of a /api/history response, keeping every stride-th one */
+typedef struct {
+    chunk_writer_t w;
+    bool binary;
+    uint64_t now;
+    size_t stride;
+    size_t seen;
+} history_writer_t;
+
+static void history_write(history_writer_t *h, const history_sample_t *samples, size_t n)
+{
+    for (size_t i = 0; i < n; ++i, ++h->seen) {
+        if (h->seen % h->stride) {
+            continue;
+        }
+        if (h->binary) {
+            uint64_t age = h->now - samples[i].t_ms;
+            uint8_t record[BINFMT_HISTORY_RECORD_SIZE];
+            binfmt_put_u16(binfmt_put_u32(record, age < UINT32_MAX ? (uint32_t)age : UINT32_MAX),
+                           (uint16_t)lroundf(samples[i].temp * 16.0f));
+            chunk_write(&h->w, record, sizeof(record));
+        } else {
+            chunk_printf(&h->w, "%s[%llu,%.2f]", h->seen ? "," : "",
+                         (unsigned long long)samples[i].t_ms, samples[i].temp);
+        }
+    }
+}
+
+static void rollup_write(history_writer_t *h, const rollup_point_t *points, size_t n)
+{
+    for (size_t i = 0; i < n; ++i, ++h->seen) {
+        if (h->seen % h->stride) {
+            continue;
+        }
+        if (h->binary) {
+            uint64_t age = h->now - points[i].t_ms;
+            uint8_t record[BINFMT_ROLLUP_RECORD_SIZE];
+            uint8_t *p = binfmt_put_u32(record, age < UINT32_MAX ? (uint32_t)age : UINT32_MAX);
+            p = binfmt_put_u16(p, (uint16_t)lroundf(points[i].avg * 16.0f));
+            p = binfmt_put_u16(p, (uint16_t)lroundf(points[i].min * 16.0f));
+            binfmt_put_u16(p, (uint16_t)lroundf(points[i].max * 16.0f));
+            chunk_write(&h->w, record, sizeof(record));
+        } else {
+            chunk_printf(&h->w, "%s[%llu,%.2f,%.2f,%.2f]", h->seen ? "," : "", (unsigned long long)points[i].t_ms,
+                         points[i].avg, points[i].min, points[i].max);
+        }
+    }
+}
+
+/* One pass over the samples of a /api/history range: raw ones from the flash log and the RAM ring, or tier averages */
+typedef struct {
+    int tier;               // -1 for raw samples
+    uint64_t from;
+    uint64_t to;
+    uint64_t split;         // the ring takes over here, the log only fills in before that
+    bool in_ring;
+    tslog_cursor_t log;
+    history_cursor_t ring;
+    rollup_cursor_t rollup;
+} range_iter_t;
+
+static void range_begin(range_iter_t *it)
+{
+    if (it->tier >= 0) {
+        rollup_cursor_init(&it->rollup, it->tier);
+        return;
+    }
+    it->in_ring = it->from >= it->split;
+    if (!it->in_ring) {
+        tslog_cursor_init(&it->log, it->from);
+    }
+    history_cursor_init(&it->ring);
+}
+
+static size_t range_next(range_iter_t *it, history_sample_t *out, size_t max)
+{
+    if (it->tier >= 0) {
+        rollup_point_t points[16];
+        size_t n = rollup_read(&it->rollup, it->from, it->to, points, max < 16 ? max : 16);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = (history_sample_t) {
+                .t_ms = points[i].t_ms,
+                .temp = points[i].avg,
+            };
+        }
+        return n;
+    }
+    if (!it->in_ring) {
+        size_t n = tslog_read(&it->log, it->from, it->to < it->split ? it->to : it->split - 1, out, max);
+        if (n > 0) {
+            return n;
+        }
+        it->in_ring = true;
     }
+    return history_read(&it->ring, it->from > it->split ? it->from : it->split, it->to, out, max);
+}
 
-    if (xSemaphoreTake(settings_mutex, pdMS_TO_TICKS(2000)) == pdTRUE) {
-        cJSON_AddNumberToObject(root, "temp", current_temperature);
-        cJSON *limits = cJSON_CreateArray();
-        for (int i = 0; i < 5; ++i)
-            cJSON_AddItemToArray(limits, cJSON_CreateNumber(g_settings.thresholds[i]));
-        cJSON_AddItemToObject(root, "limits", limits);
-        xSemaphoreGive(settings_mutex);
+/*
+ * GET /api/history?from=&to=&max=&points= : times are history_now_ms(), as "now" in the response.
+ * Samples older than the RAM ring come from the flash log. When there are more than max of them
+ * the response holds [t, avg, min, max] buckets of a rollup tier instead, "tier" is its period.
+ * With points=N the range is downsampled with LTTB to at most N [t, temp] pairs, from the raw
+ * samples or, for long ranges, from the tier averages.
+ */
+static esp_err_t serve_history(httpd_req_t *req, bool binary)
+{
+    char query[112] = "";
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    uint64_t now = history_now_ms();
+    range_iter_t range = {
+        .tier = -1,
+        .from = query_u64(query, "from", 0),
+        .to = query_u64(query, "to", now),
+        .split = history_oldest_ms(),
+    };
+    uint64_t max = query_u64(query, "max", HISTORY_DEFAULT_POINTS);
+    if (max == 0 || max > HISTORY_CAPACITY) {
+        max = HISTORY_CAPACITY;
+    }
+    uint64_t points = query_u64(query, "points", 0);
+    if (points > LTTB_MAX_POINTS) {
+        points = LTTB_MAX_POINTS;
+    }
+    // LTTB reads its input twice, at most a ring's worth of it
+    uint64_t budget = points ? HISTORY_CAPACITY : max;
+
+    uint64_t log_to = range.to < range.split ? range.to : range.split - 1;
+    uint64_t ring_from = range.from > range.split ? range.from : range.split;
+    size_t count = (range.from < range.split ? tslog_count(range.from, log_to) : 0) + history_count(ring_from, range.to);
+    uint32_t period = 0;
+    if (count > budget) {
+        range.tier = rollup_pick_tier(range.from, range.to, budget);
+        period = rollup_period_ms(range.tier);
+        count = rollup_count(range.tier, range.from, range.to);
+    }
+    bool envelope = range.tier >= 0 && !points;
+
+    // still more than asked for (only with the coarsest tier): keep every stride-th one
+    history_writer_t h = {
+        .w = { .req = req },
+        .binary = binary,
+        .now = now,
+        .stride = points ? 1 : (count + max - 1) / max,
+    };
+    if (h.stride == 0) {
+        h.stride = 1;
+    }
+
+    httpd_resp_set_type(req, binary ? BINFMT_CONTENT_TYPE : "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "Vary", "Accept");
+    if (binary && envelope) {
+        uint8_t header[BINFMT_HEADER_SIZE + 12];
+        uint8_t *p = binfmt_put_header(header, BINFMT_KIND_ROLLUP, BINFMT_ROLLUP_RECORD_SIZE);
+        binfmt_put_u32(binfmt_put_u64(p, now), period);
+        chunk_write(&h.w, header, sizeof(header));
+    } else if (binary) {
+        uint8_t header[BINFMT_HEADER_SIZE + 8];
+        binfmt_put_u64(binfmt_put_header(header, BINFMT_KIND_HISTORY, BINFMT_HISTORY_RECORD_SIZE), now);
+        chunk_write(&h.w, header, sizeof(header));
     } else {
-        ESP_LOGW(TAG, "api_data: mutex timeout");
+        chunk_printf(&h.w, "{\"now\":%llu,\"tier\":%lu,\"points\":[", (unsigned long long)now, (unsigned long)period);
     }
 
-    char *out = cJSON_PrintUnformatted(root);
-    if (out) {
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_send(req, out, HTTPD_RESP_USE_STRLEN);
-        free(out);
+    // handlers run one at a time on the httpd task, so one set of buffers will do, and they stay off its stack
+    static history_sample_t samples[32];
+    size_t n;
+    if (envelope) {
+        rollup_cursor_t rollup_cursor;
+        static rollup_point_t buckets[16];
+        rollup_cursor_init(&rollup_cursor, range.tier);
+        while (h.w.err == ESP_OK && (n = rollup_read(&rollup_cursor, range.from, range.to, buckets, 16)) > 0) {
+            rollup_write(&h, buckets, n);
+        }
+    } else if (points && count > points && points < 3) {
+        // too few for LTTB's buckets: the first sample, and the last one when two are asked for
+        history_sample_t ends[2] = {};
+        size_t seen = 0;
+        range_begin(&range);
+        while ((n = range_next(&range, samples, 32)) > 0) {
+            if (seen == 0) {
+                ends[0] = samples[0];
+            }
+            ends[1] = samples[n - 1];
+            seen += n;
+        }
+        history_write(&h, ends, seen < points ? seen : points);
+    } else if (points && count > points) {
+        static lttb_t s_lttb;
+        static history_sample_t picked[32 + 1];
+        lttb_begin(&s_lttb, count, points);
+        range_begin(&range);
+        while ((n = range_next(&range, samples, 32)) > 0) {
+            lttb_scan(&s_lttb, samples, n);
+        }
+        range_begin(&range);
+        while (h.w.err == ESP_OK && (n = range_next(&range, samples, 32)) > 0) {
+            history_write(&h, picked, lttb_select(&s_lttb, samples, n, picked));
+        }
+        history_write(&h, picked, lttb_finish(&s_lttb, picked));
     } else {
-        httpd_resp_send_500(req);
-        cJSON_Delete(root);
-        return ESP_FAIL;
+        range_begin(&range);
+        while (h.w.err == ESP_OK && (n = range_next(&range, samples, 32)) > 0) {
+            history_write(&h, samples, n);
+        }
+    }
+    if (!binary) {
+        chunk_printf(&h.w, "]}");
+    }
+    chunk_flush(&h.w);
+    if (h.w.err != ESP_OK) {
+        return h.w.err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t api_history_get_handler(httpd_req_t *req)
+{
+    return serve_history(req, accepts_binary(req));
+}
+
+static esp_err_t api_history_bin_get_handler(httpd_req_t *req)
+{
+    return serve_history(req, true);
+}
+
+// --- WebSocket push ---
+/* Runs in the httpd task. arg is the socket of a new client, or -1 to push to every client */
+static void ws_push_work(void *arg)
+{
+    int only_fd = (int)(intptr_t)arg;
+    char frame_buf[SNAPSHOT_MAX_LEN];
+
+    if (only_fd < 0) {
+        atomic_store(&s_push_pending, false);
+    }
+    // same payload as /api/data
+    uint32_t seq;
+    size_t len = snapshot_read(SNAPSHOT_JSON, frame_buf, sizeof(frame_buf), &seq);
+    if (len == 0) {
+        return;
+    }
+    if (only_fd < 0) {
+        if (seq == s_last_pushed_seq) {
+            return;
+        }
+        s_last_pushed_seq = seq;
     }
 
-    cJSON_Delete(root);
+    int fds[WS_MAX_CLIENTS];
+    size_t count = WS_MAX_CLIENTS;
+    if (httpd_get_client_list(s_server, &count, fds) != ESP_OK) {
+        return;
+    }
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)frame_buf,
+        .len = len,
+    };
+    for (size_t i = 0; i < count; ++i) {
+        if ((only_fd >= 0 && fds[i] != only_fd) ||
+                httpd_ws_get_fd_info(s_server, fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            continue;
+        }
+        if (httpd_ws_send_frame_async(s_server, fds[i], &frame) != ESP_OK) {
+            ESP_LOGD(TAG, "ws push to fd %d failed", fds[i]);
+        }
+    }
+}
+
+void webserver_notify_update(void)
+{
+    if (s_longpoll_task) {
+        xTaskNotifyGive(s_longpoll_task);
+    }
+    if (!s_server || atomic_exchange(&s_push_pending, true)) {
+        return; // not started, or a push is already queued and will carry this update
+    }
+    if (httpd_queue_work(s_server, ws_push_work, (void *)(intptr_t)-1) != ESP_OK) {
+        atomic_store(&s_push_pending, false);
+    }
+}
+
+/* Sample bus consumer: renders the newest sample once, then wakes the long-poll task and the /ws push */
+static void web_sample_task(void *arg)
+{
+    sample_bus_sub_t *sub = sample_bus_subscribe("web");
+    sample_t sample;
+    while (sub != NULL) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bool got = false;
+        while (sample_bus_take(sub, &sample)) {
+            got = true;
+        }
+        if (got && snapshot_publish()) {
+            webserver_notify_update();
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // handshake done, the new client gets the current state right away
+        ESP_LOGI(TAG, "ws client connected, fd %d", httpd_req_to_sockfd(req));
+        httpd_queue_work(req->handle, ws_push_work, (void *)(intptr_t)httpd_req_to_sockfd(req));
+        return ESP_OK;
+    }
+
+    // nothing is expected from the page, drain whatever it sends
+    uint8_t buf[32];
+    httpd_ws_frame_t frame = { .payload = buf };
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK || frame.len > sizeof(buf)) {
+        return ESP_FAIL;
+    }
+    if (frame.len) {
+        return httpd_ws_recv_frame(req, &frame, frame.len);
+    }
     return ESP_OK;
 }
 
+/* Settings generation from If-Match ("7", 7 or *), THERMOSTAT_ANY_GENERATION without the header */
+static bool if_match_generation(httpd_req_t *req, uint32_t *generation)
+{
+    char value[16];
+    *generation = THERMOSTAT_ANY_GENERATION;
+    size_t len = httpd_req_get_hdr_value_len(req, "If-Match");
+    if (len == 0) {
+        return true;
+    }
+    if (len >= sizeof(value) || httpd_req_get_hdr_value_str(req, "If-Match", value, sizeof(value)) != ESP_OK) {
+        return false;
+    }
+    if (strcmp(value, "*") == 0) {
+        return true;
+    }
+    const char *digits = value[0] == '"' ? value + 1 : value;
+    char *end = NULL;
+    unsigned long parsed = strtoul(digits, &end, 10);
+    if (end == digits || (value[0] == '"' ? strcmp(end, "\"") : *end) != 0 || parsed >= THERMOSTAT_ANY_GENERATION) {
+        return false;
+    }
+    *generation = parsed;
+    return true;
+}
+
+static void set_generation_etag(httpd_req_t *req, char *buf, size_t size, uint32_t generation)
+{
+    snprintf(buf, size, "\"%lu\"", (unsigned long)generation);
+    httpd_resp_set_hdr(req, "ETag", buf);
+}
+
+/* POST /api/settings, with If-Match: "<gen>" the update only applies if nobody else changed the settings since */
 static esp_err_t api_settings_post_handler(httpd_req_t *req)
 {
     int remaining = req->content_len;
     if (remaining <= 0) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad Request");
-
-    char *buf = malloc(remaining + 1);
-    if (!buf) return httpd_resp_send_500(req);
-
-    int total = 0, to_read = remaining;
-    while (to_read > 0) {
-        int r = httpd_req_recv(req, buf + total, to_read);
-        if (r <= 0) { free(buf); return httpd_resp_send_500(req); }
-        total += r; to_read -= r;
+    if (remaining > SETTINGS_MAX_BODY) {
+        // refused before reading, httpd drops the unread body
+        httpd_resp_set_status(req, "413 Payload Too Large");
+        return httpd_resp_send(req, "Payload Too Large", HTTPD_RESP_USE_STRLEN);
     }
-    buf[total] = '\0';
 
-    cJSON *root = cJSON_Parse(buf);
-    free(buf);
-    if (!root) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad Request");
+    // parsed chunk by chunk from a small buffer, nothing is allocated
+    settings_parser_t parser;
+    settings_parser_init(&parser);
+    char chunk[64];
+    int timeouts = 0;
+    while (remaining > 0) {
+        int r = httpd_req_recv(req, chunk, remaining < (int)sizeof(chunk) ? remaining : (int)sizeof(chunk));
+        if (r == HTTPD_SOCK_ERR_TIMEOUT) {
+            // a client that stops sending would otherwise hold the httpd task forever
+            if (++timeouts >= RECV_MAX_TIMEOUTS) {
+                return httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, "Request Timeout");
+            }
+            continue;
+        }
+        if (r <= 0) return httpd_resp_send_500(req);
+        timeouts = 0;
+        remaining -= r;
+        if (settings_parser_feed(&parser, chunk, r) == SETTINGS_PARSE_ERROR) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed JSON");
+        }
+    }
 
-    cJSON *limits = cJSON_GetObjectItem(root, "limits");
-    if (!limits || !cJSON_IsArray(limits) || cJSON_GetArraySize(limits) != 5) {
-        cJSON_Delete(root);
-        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad Request");
+    settings_update_t update;
+    const char *reason = settings_parser_finish(&parser, &update);
+    if (reason) return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, reason);
+    uint32_t if_generation;
+    if (!if_match_generation(req, &if_generation)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad If-Match");
     }
 
-    if (xSemaphoreTake(settings_mutex, pdMS_TO_TICKS(2000)) == pdTRUE) {
-        for (int i = 0; i < 5; ++i) {
-            cJSON *it = cJSON_GetArrayItem(limits, i);
-            if (it && cJSON_IsNumber(it)) g_settings.thresholds[i] = (float)it->valuedouble;
-        }
-        save_thresholds();  // <-- сохраняем в NVS
-        xSemaphoreGive(settings_mutex);
-    } else {
-        cJSON_Delete(root);
-        return httpd_resp_send_500(req);
+    // stale writers are turned away here, before anything is published or saved
+    uint32_t generation;
+    bool changed;
+    char etag[16];
+    bool applied = thermostat_publish_settings(update.has_limits ? update.limits : NULL,
+                                               update.has_period ? update.period_ms : 0, if_generation,
+                                               &generation, &changed);
+    set_generation_etag(req, etag, sizeof(etag), generation);
+    if (!applied) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_send(req, "Settings changed meanwhile", HTTPD_RESP_USE_STRLEN);
+    }
+    if (changed) {
+        // saved even if another task rendered the new values first and our publish finds nothing new
+        settings_store_mark_dirty();  // NVS is written later, by the settings store
+    }
+    if (snapshot_publish()) {
+        webserver_notify_update();
     }
 
-    cJSON_Delete(root);
     return httpd_resp_send(req, "OK", HTTPD_RESP_USE_STRLEN);
 }
 
-static esp_err_t css_handler(httpd_req_t *req) { return send_gzip_asset(req, _binary_style_css_gz_start, _binary_style_css_gz_end, "text/css"); }
-static esp_err_t js_handler(httpd_req_t *req)  { return send_gzip_asset(req, _binary_script_js_gz_start, _binary_script_js_gz_end, "application/javascript"); }
+static esp_err_t css_handler(httpd_req_t *req) { return send_gzip_asset(req, _binary_style_css_gz_start, _binary_style_css_gz_end, "text/css", ASSET_ETAG_STYLE); }
+static esp_err_t js_handler(httpd_req_t *req)  { return send_gzip_asset(req, _binary_script_js_gz_start, _binary_script_js_gz_end, "application/javascript", ASSET_ETAG_SCRIPT); }
 
 void start_webserver(void)
 {
-    load_thresholds(); // <-- загружаем настройки при старте
+    settings_store_init(); // <-- загружаем настройки при старте
+    s_boot_id = esp_random();
+    snapshot_publish();
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.max_uri_handlers = 10;
@@ -172,11 +739,28 @@ void start_webserver(void)
         return;
     }
 
+    s_parked_mutex = xSemaphoreCreateMutex();
+    configASSERT(s_parked_mutex);
+    if (xTaskCreate(longpoll_task, "longpoll", 3072, NULL, 5, &s_longpoll_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create longpoll task");
+    }
+    // below the sensor task: a slow client delays the pages, never the next sample
+    if (xTaskCreate(web_sample_task, "web_sample", 3072, NULL, 4, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create web_sample task");
+    }
+
     httpd_register_uri_handler(server, &(httpd_uri_t){"/", HTTP_GET, root_handler, NULL});
     httpd_register_uri_handler(server, &(httpd_uri_t){"/style.css", HTTP_GET, css_handler, NULL});
     httpd_register_uri_handler(server, &(httpd_uri_t){"/script.js", HTTP_GET, js_handler, NULL});
     httpd_register_uri_handler(server, &(httpd_uri_t){"/api/data", HTTP_GET, api_data_get_handler, NULL});
     httpd_register_uri_handler(server, &(httpd_uri_t){"/api/settings", HTTP_POST, api_settings_post_handler, NULL});
+    httpd_register_uri_handler(server, &(httpd_uri_t){"/api/history", HTTP_GET, api_history_get_handler, NULL});
+    httpd_register_uri_handler(server, &(httpd_uri_t){"/api/data.bin", HTTP_GET, api_data_bin_get_handler, NULL});
+    httpd_register_uri_handler(server, &(httpd_uri_t){"/api/history.bin", HTTP_GET, api_history_bin_get_handler, NULL});
+    httpd_register_uri_handler(server, &(httpd_uri_t){
+        .uri = "/ws", .method = HTTP_GET, .handler = ws_handler, .is_websocket = true
+    });
+    s_server = server;
 
     ESP_LOGI(TAG, "HTTP server started");
 }
@@ -0,0 +1,77 @@
+#include <string.h>
+#include "esp_log.h"
+#include "unity.h"
+#include "unity_test_runner.h"
+#include "settings_parser.h"
+
+static const char *TAG = "test-app";
+
+/* Feeds the body in chunks of chunk_len bytes, returns what settings_parser_finish() says */
+static const char *parse(const char *body, size_t chunk_len, settings_update_t *update)
+{
+    settings_parser_t parser;
+    settings_parser_init(&parser);
+    memset(update, 0, sizeof(*update));
+    size_t len = strlen(body);
+    for (size_t i = 0; i < len; i += chunk_len) {
+        size_t n = len - i < chunk_len ? len - i : chunk_len;
+        if (settings_parser_feed(&parser, body + i, n) == SETTINGS_PARSE_ERROR) {
+            return "parse error";
+        }
+    }
+    return settings_parser_finish(&parser, update);
+}
+
+TEST_CASE("settings parser takes limits and period", "[settings_parser]")
+{
+    settings_update_t update;
+    const char *body = "{\"limits\":[20,22.25,25,28,32.5],\"period_ms\":2000}";
+    TEST_ASSERT_NULL(parse(body, strlen(body), &update));
+    TEST_ASSERT_TRUE(update.has_limits);
+    TEST_ASSERT_EQUAL_FLOAT(22.25f, update.limits[1]);
+    TEST_ASSERT_EQUAL_FLOAT(32.5f, update.limits[4]);
+    TEST_ASSERT_TRUE(update.has_period);
+    TEST_ASSERT_EQUAL(2000, update.period_ms);
+    // the same in one-byte chunks
+    TEST_ASSERT_NULL(parse(body, 1, &update));
+    TEST_ASSERT_EQUAL_FLOAT(22.25f, update.limits[1]);
+    TEST_ASSERT_EQUAL(2000, update.period_ms);
+}
+
+TEST_CASE("settings parser skips a key with an escaped quote", "[settings_parser]")
+{
+    settings_update_t update;
+    const char *body = "{\"a\\\"b\":1,\"period_ms\":2000}";
+    for (size_t chunk_len = 1; chunk_len <= strlen(body); chunk_len++) {
+        TEST_ASSERT_NULL(parse(body, chunk_len, &update));
+        TEST_ASSERT_FALSE(update.has_limits);
+        TEST_ASSERT_TRUE(update.has_period);
+        TEST_ASSERT_EQUAL(2000, update.period_ms);
+    }
+    // an escaped backslash does not escape the closing quote, and an unknown array value is skipped
+    body = "{\"x\\\\\":\"v\\\"w\",\"li\\\"mits\":[1,2],\"limits\":[20,22,25,28,32]}";
+    TEST_ASSERT_NULL(parse(body, 1, &update));
+    TEST_ASSERT_TRUE(update.has_limits);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, update.limits[0]);
+    // a key whose closing quote is escaped never ends
+    TEST_ASSERT_EQUAL_STRING("Malformed JSON", parse("{\"a\\\":1}", 1, &update));
+}
+
+TEST_CASE("settings parser refuses bad values", "[settings_parser]")
+{
+    settings_update_t update;
+    TEST_ASSERT_EQUAL_STRING("Nothing to update", parse("{\"x\":1}", 64, &update));
+    TEST_ASSERT_EQUAL_STRING("Sample period out of range", parse("{\"period_ms\":150}", 64, &update));
+    TEST_ASSERT_EQUAL_STRING("Sample period out of range", parse("{\"period_ms\":1000.5}", 64, &update));
+    TEST_ASSERT_EQUAL_STRING("Thresholds must be in ascending order", parse("{\"limits\":[5,2,3,4,5]}", 64, &update));
+    TEST_ASSERT_EQUAL_STRING("parse error", parse("{\"limits\":[1,2,3,4]}", 64, &update));
+    TEST_ASSERT_EQUAL_STRING("parse error", parse("{\"period_ms\":\"1000\"}", 64, &update));
+}
+
+void app_main(void)
+{
+    ESP_LOGI(TAG, "running the settings parser tests");
+    UNITY_BEGIN();
+    unity_run_all_tests();
+    UNITY_END();
+}
@@ -0,0 +1,10 @@
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+import pytest
+from pytest_embedded import Dut
+
+
+@pytest.mark.linux
+@pytest.mark.host_test
+def test_settings_parser(dut: Dut) -> None:
+    dut.expect_exact('test-app: running the settings parser tests')
+    dut.expect(r'\d+ Tests 0 Failures 0 Ignored', timeout=60)